@@ -22,6 +22,15 @@
 
 // End of VM_ defines
 
+// Run the development tests of VirtualHardwareWrapper in setup()
+// #define TEST_ETHERNET_WRAPPER
+// #define TEST_ETHERNET_WRAPPER_SOAK
+// #define TEST_TIMING_WRAPPER
+// #define TEST_PROCESS_SYNCHRONIZATION_WRAPPER
+// #define TEST_VIRTUAL_TWI_WRAPPER
+// #define TEST_DEVICE_MODELS
+// #define TEST_GPIO_WRAPPER
+
 #define ARDUINO 10800
 #define __AVR_ATmega328P__ // Arduino UNO
 
@@ -35,6 +44,22 @@
 #include <EthernetServer.h>
 #include <SoftwareSerial.h>
 
+#if defined(TEST_ETHERNET_WRAPPER) || defined(TEST_ETHERNET_WRAPPER_SOAK)
+#include "TestEthernetWrapper.h"
+#endif
+#ifdef TEST_TIMING_WRAPPER
+#include "TestTimingWrapper.h"
+#endif
+#ifdef TEST_PROCESS_SYNCHRONIZATION_WRAPPER
+#include "TestProcessSynchronizationWrapper.h"
+#endif
+#ifdef TEST_VIRTUAL_TWI_WRAPPER
+#include "TestVirtualTwiWrapper.h"
+#endif
+#ifdef TEST_GPIO_WRAPPER
+#include "TestGPIOWrapper.h"
+#endif
+
 #define PCA9555 B01000000/2
 #define PCA9555_INPUT_0 0
 #define PCA9555_INPUT_1 1
@@ -45,6 +70,10 @@
 #define PCA9555_CFG_0 6
 #define PCA9555_CFG_1 7
 
+#ifdef TEST_DEVICE_MODELS
+#include "TestDeviceModels.h"
+#endif
+
 // set pin 10 as the slave select for the digital pot:
 const int slaveSelectPin = 13;
 
@@ -147,6 +176,46 @@ void ethernetSetup()
 
 void setup()
 {
+#ifdef TEST_ETHERNET_WRAPPER
+    Serial.begin(9600);
+    testEthernetWrapperReadCost();
+    testEthernetWrapperUdpFlood();
+    testEthernetWrapperUdpSendRate();
+    testEthernetWrapperAsyncConnect();
+    testEthernetWrapperDnsCache();
+    testEthernetWrapperAcceptStorm();
+#endif
+#ifdef TEST_ETHERNET_WRAPPER_SOAK
+    Serial.begin(9600);
+    testEthernetWrapperSoak();
+#endif
+#ifdef TEST_TIMING_WRAPPER
+    Serial.begin(9600);
+    testTimingWrapperCost();
+    testMonotonicClockDrift();
+    testVirtualTimeDay();
+#endif
+#ifdef TEST_PROCESS_SYNCHRONIZATION_WRAPPER
+    Serial.begin(9600);
+    testNodeSchedulerThroughput();
+#endif
+#ifdef TEST_VIRTUAL_TWI_WRAPPER
+    Serial.begin(9600);
+    testTwiLocalBusTransactions();
+    testVirtualTwiWrapperRxSoak();
+    testVirtualTwiWrapperTransactions();
+#endif
+#ifdef TEST_DEVICE_MODELS
+    Serial.begin(9600);
+    testDeviceModels();
+#endif
+#ifdef TEST_GPIO_WRAPPER
+    Serial.begin(9600);
+    testGPIOWrapperBitBang();
+    testGPIOWrapperToggle();
+    testGPIOWrapperInterrupts();
+#endif
+
     ethernetSetup();
 
     // set the slaveSelectPin as an output:
@@ -0,0 +1,95 @@
+// Development tests of the native device models, without VM_TWI_MODELS the models are created here
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <TwiLocalBus.h>
+#include <Pca9555Model.h>
+#include <EepromModel.h>
+#include <Bme280Model.h>
+#include <Mcp4822Model.h>
+#include <MonotonicClock.h>
+
+// The PCA9555 pattern of this sketch one million times, then the timing of EEPROM and BME280
+static void testDeviceModels()
+{
+    const long transactions = 1000000;
+
+    Pca9555Model expander;
+    EepromModel eeprom(32768, 64);
+    Bme280Model sensor;
+    TwiLocalBus expanderBus, eepromBus, sensorBus, master;
+    expanderBus.begin(0x21, &expander);
+    eepromBus.begin(0x51, &eeprom);
+    sensorBus.begin(0x77, &sensor);
+    master.begin(0, NULL);
+
+    unsigned char configuration[3] = { PCA9555_CFG_0, 0x00, 0x00 };
+    master.writeTo(0x21, configuration, sizeof(configuration));
+    unsigned char output[3] = { PCA9555_OUTPUT_0, 0x00, 0x00 };
+    unsigned char input = PCA9555_INPUT_0;
+    unsigned char levels[2];
+    long errors = 0;
+    MonotonicClock clock;
+    for (long i = 0; i < transactions; i++) {
+        output[1] = (unsigned char)i;
+        output[2] = (unsigned char)~i;
+        master.writeTo(0x21, output, sizeof(output));
+        master.writeTo(0x21, &input, 1);
+        if (master.readFrom(0x21, levels, 2) != 2 || levels[0] != output[1] || levels[1] != output[2]) {
+            errors++;
+        }
+    }
+    unsigned long micros = clock.micros();
+    Serial.print("PCA9555 model: ");
+    Serial.print((unsigned long)(3 * transactions * 1000000.0 / micros));
+    Serial.print(" transactions/s, ");
+    Serial.print(errors);
+    Serial.println(" errors");
+
+    // acknowledge polling after a page write
+    unsigned char page[2 + 16] = { 0x01, 0x00 };
+    master.writeTo(0x51, page, sizeof(page));
+    MonotonicClock writeCycle;
+    long polls = 0;
+    while (master.writeTo(0x51, page, 2) != 0) {
+        polls++;
+    }
+    Serial.print("24LC256 model: write cycle ");
+    Serial.print(writeCycle.micros());
+    Serial.print(" us, ");
+    Serial.print(polls);
+    Serial.println(" NACKed polls");
+
+    // forced measurement, 1x oversampling of all values
+    unsigned char humidity[2] = { 0xf2, 0x01 };
+    unsigned char measurement[2] = { 0xf4, 0x25 };
+    unsigned char status = 0xf3;
+    unsigned char value = 0;
+    master.writeTo(0x77, humidity, sizeof(humidity));
+    master.writeTo(0x77, measurement, sizeof(measurement));
+    MonotonicClock measuring;
+    do {
+        master.writeTo(0x77, &status, 1);
+        master.readFrom(0x77, &value, 1);
+    } while ((value & 0x08) != 0);
+    Serial.print("BME280 model: forced measurement ");
+    Serial.print(measuring.micros());
+    Serial.println(" us");
+
+    // channel A, 1x gain, 0x800 is half of the 2.048 V reference
+    Mcp4822Model dac;
+    unsigned char command[2] = { 0x38, 0x00 };
+    unsigned char ignored[2];
+    dac.select();
+    dac.transfer(command, ignored, sizeof(command));
+    dac.deselect();
+    Serial.print("MCP4822 model: channel A ");
+    Serial.print(dac.millivolts(0));
+    Serial.println(" mV");
+}
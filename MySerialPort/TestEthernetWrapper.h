@@ -0,0 +1,418 @@
+// Development tests of EthernetWrapper, run over a loopback connection
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <EthernetWrapper.h>
+
+#pragma comment(lib, "psapi.lib")
+
+static size_t privateBytes()
+{
+    PROCESS_MEMORY_COUNTERS_EX counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+    return counters.PrivateUsage;
+}
+
+// One million calls of every string and IPv4 accessor must not grow the private bytes of the process
+static void testEthernetWrapperSoak()
+{
+    const unsigned int port = 5005;
+    const long calls = 1000000;
+
+    EthernetWrapper ethernet;
+    int serverSocket = -1;
+    int clientSocket = -1;
+    int acceptedSocket = -1;
+
+    ethernet.serverBegin("127.0.0.1", port, &serverSocket);
+    ethernet.clientConnect("127.0.0.1", port, &clientSocket);
+    for (int i = 0; i < 1000 && acceptedSocket < 0; i++) {
+        acceptedSocket = ethernet.serverAccept(serverSocket);
+        Sleep(1);
+    }
+    if (acceptedSocket < 0) {
+        Serial.println("EthernetWrapper soak: no connection accepted");
+        return;
+    }
+
+    // warm up the interned strings and the managed runtime
+    size_t before = 0;
+    for (long i = 0; i < calls + 1000; i++) {
+        if (i == 1000) {
+            before = privateBytes();
+        }
+        ethernet.clientRemoteIpAddress(acceptedSocket);
+        ethernet.clientRemoteIp(acceptedSocket);
+        ethernet.clientErrorMessage(-1);
+        ethernet.clientSocketErrorCode(acceptedSocket);
+        ethernet.serverErrorMessage(serverSocket);
+        ethernet.serverSocketErrorCode(serverSocket);
+    }
+    size_t after = privateBytes();
+
+    Serial.print("EthernetWrapper soak: ");
+    Serial.print(calls);
+    Serial.print(" calls, private bytes ");
+    Serial.print((unsigned long)before);
+    Serial.print(" -> ");
+    Serial.print((unsigned long)after);
+    Serial.print(", remote ");
+    Serial.println(ethernet.clientRemoteIpAddress(acceptedSocket));
+
+    ethernet.clientStop(acceptedSocket);
+    ethernet.clientStop(clientSocket);
+}
+
+// Per byte cost of the Arduino "while (client.available()) client.read();" pattern
+static void testEthernetWrapperReadCost()
+{
+    const unsigned int port = 5006;
+    const long totalBytes = 1L << 20;
+
+    EthernetWrapper ethernet;
+    int serverSocket = -1;
+    int clientSocket = -1;
+    int acceptedSocket = -1;
+
+    ethernet.serverBegin("127.0.0.1", port, &serverSocket);
+    ethernet.clientConnect("127.0.0.1", port, &clientSocket);
+    for (int i = 0; i < 1000 && acceptedSocket < 0; i++) {
+        acceptedSocket = ethernet.serverAccept(serverSocket);
+        Sleep(1);
+    }
+    if (acceptedSocket < 0) {
+        Serial.println("EthernetWrapper read cost: no connection accepted");
+        return;
+    }
+
+    unsigned char chunk[512];
+    memset(chunk, 'x', sizeof(chunk));
+    long sent = 0;
+    long received = 0;
+    LARGE_INTEGER frequency, start, stop;
+    LONGLONG readTicks = 0;
+    QueryPerformanceFrequency(&frequency);
+
+    while (received < totalBytes) {
+        if (sent < totalBytes) {
+            sent += ethernet.clientWrite(clientSocket, chunk, sizeof(chunk));
+        }
+
+        // only the reads are timed, not the writes of the peer
+        QueryPerformanceCounter(&start);
+        while (ethernet.clientAvailable(acceptedSocket) > 0) {
+            unsigned char b;
+            if (ethernet.clientRead(acceptedSocket, &b, 1) == 1) {
+                received++;
+            }
+        }
+        QueryPerformanceCounter(&stop);
+        readTicks += stop.QuadPart - start.QuadPart;
+    }
+
+    Serial.print("EthernetWrapper read cost: ");
+    Serial.print((double)readTicks * 1e9 / frequency.QuadPart / received);
+    Serial.println(" ns per byte for available() + read()");
+
+    ethernet.clientStop(acceptedSocket);
+    ethernet.clientStop(clientSocket);
+}
+
+// A thread floods a UDP socket with 100000 numbered datagrams of 32 bytes while this thread
+// parses and reads them; every datagram must arrive, be dropped by the ring or by the OS
+static void testEthernetWrapperUdpFlood()
+{
+    const unsigned int port = 5007;
+    const long datagrams = 100000;
+
+    EthernetWrapper receiver;
+    int receiverSocket = -1;
+    if (receiver.udpBegin(port, &receiverSocket) != 1) {
+        Serial.println("EthernetWrapper UDP flood: cannot open the receiving socket");
+        return;
+    }
+
+    std::atomic<bool> sending(true);
+    std::thread sender([&sending]() {
+        EthernetWrapper ethernet;
+        int socket = -1;
+        ethernet.udpBegin(port + 1, &socket);
+        unsigned char datagram[32];
+        memset(datagram, 'x', sizeof(datagram));
+        for (long i = 0; i < datagrams; i++) {
+            memcpy(datagram, &i, sizeof(i));
+            ethernet.udpBeginPacket(socket, "127.0.0.1", port);
+            ethernet.udpWrite(socket, datagram, sizeof(datagram));
+            ethernet.udpEndPacket(socket);
+        }
+        ethernet.udpClose(socket);
+        sending = false;
+    });
+
+    long received = 0;
+    long disordered = 0;
+    long last = -1;
+    unsigned int remoteIpAddress, remotePort;
+    unsigned char datagram[32];
+    LARGE_INTEGER frequency, start, stop;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    // the last datagrams may still be on their way when the sender ends
+    for (int idle = 0; sending || idle < 100; ) {
+        if (receiver.udpParsePacket(receiverSocket, &remoteIpAddress, &remotePort) <= 0) {
+            if (!sending) {
+                idle++;
+                Sleep(1);
+            }
+            continue;
+        }
+        long number;
+        if (receiver.udpRead(receiverSocket, datagram, sizeof(datagram)) != sizeof(datagram)) {
+            disordered++;
+            continue;
+        }
+        memcpy(&number, datagram, sizeof(number));
+        if (number <= last) {
+            disordered++;
+        }
+        last = number;
+        received++;
+    }
+    QueryPerformanceCounter(&stop);
+    sender.join();
+
+    unsigned long dropped = receiver.udpDroppedPackets(receiverSocket);
+    Serial.print("EthernetWrapper UDP flood: ");
+    Serial.print(received);
+    Serial.print(" received, ");
+    Serial.print(dropped);
+    Serial.print(" dropped by the ring, ");
+    Serial.print(datagrams - received - (long)dropped);
+    Serial.print(" lost by the OS, ");
+    Serial.print(disordered);
+    Serial.print(" bad, ");
+    Serial.print((unsigned long)(received * (double)frequency.QuadPart / (stop.QuadPart - start.QuadPart)));
+    Serial.println(" datagrams/s");
+
+    receiver.udpClose(receiverSocket);
+}
+
+// 100000 datagrams of 16 bytes to a loopback port, once sent by every udpEndPacket() and once
+// queued in batch mode for the reactor thread; a full batch queue is retried
+static void testEthernetWrapperUdpSendRate()
+{
+    const unsigned int port = 5009;
+    const long datagrams = 100000;
+
+    EthernetWrapper ethernet;
+    int socket = -1;
+    if (ethernet.udpBegin(port + 1, &socket) != 1) {
+        Serial.println("EthernetWrapper UDP send rate: cannot open the socket");
+        return;
+    }
+
+    unsigned char datagram[16];
+    memset(datagram, 'x', sizeof(datagram));
+    LARGE_INTEGER frequency, start, stop;
+    QueryPerformanceFrequency(&frequency);
+    for (int batch = 0; batch < 2; batch++) {
+        ethernet.udpSetBatchMode(socket, batch != 0);
+        long retries = 0;
+        QueryPerformanceCounter(&start);
+        for (long i = 0; i < datagrams; i++) {
+            memcpy(datagram, &i, sizeof(i));
+            do {
+                ethernet.udpBeginPacket(socket, "127.0.0.1", port);
+                ethernet.udpWrite(socket, datagram, sizeof(datagram));
+            } while (ethernet.udpEndPacket(socket) <= 0 && ++retries);
+        }
+        QueryPerformanceCounter(&stop);
+
+        Serial.print(batch != 0 ? "EthernetWrapper UDP send rate, batch mode: " : "EthernetWrapper UDP send rate: ");
+        Serial.print((unsigned long)(datagrams * (double)frequency.QuadPart / (stop.QuadPart - start.QuadPart)));
+        Serial.print(" datagrams/s, ");
+        Serial.print(retries);
+        Serial.println(" retries");
+    }
+
+    ethernet.udpClose(socket);
+}
+
+// clientConnect() in async mode must return at once, to a listening loopback port the status
+// goes from SYNSENT to ESTABLISHED, to an unroutable address to CLOSED after the timeout
+static void testEthernetWrapperAsyncConnect()
+{
+    const unsigned int port = 5011;
+    const unsigned int timeout = 500;
+
+    EthernetWrapper ethernet;
+    int serverSocket = -1;
+    ethernet.serverBegin("127.0.0.1", port, &serverSocket);
+    ethernet.clientSetConnectionTimeout(timeout);
+    ethernet.clientSetAsyncConnect(true);
+
+    const char* hosts[2] = { "127.0.0.1", "10.255.255.1" };
+    LARGE_INTEGER frequency, start, returned, stop;
+    QueryPerformanceFrequency(&frequency);
+    for (int i = 0; i < 2; i++) {
+        int clientSocket = -1;
+        QueryPerformanceCounter(&start);
+        int result = ethernet.clientConnect(hosts[i], port, &clientSocket);
+        QueryPerformanceCounter(&returned);
+        unsigned char status = 0x15;
+        for (int polls = 0; result == 1 && status == 0x15 && polls < 10 * (int)timeout; polls++) {
+            status = ethernet.clientStatus(clientSocket);
+            Sleep(1);
+        }
+        QueryPerformanceCounter(&stop);
+
+        Serial.print("EthernetWrapper async connect to ");
+        Serial.print(hosts[i]);
+        Serial.print(": returned ");
+        Serial.print(result);
+        Serial.print(" after ");
+        Serial.print((double)(returned.QuadPart - start.QuadPart) * 1e3 / frequency.QuadPart);
+        Serial.print(" ms, status 0x");
+        Serial.print(status, HEX);
+        Serial.print(" after ");
+        Serial.print((double)(stop.QuadPart - start.QuadPart) * 1e3 / frequency.QuadPart);
+        Serial.println(" ms");
+        ethernet.clientStop(clientSocket);
+    }
+
+    int acceptedSocket = ethernet.serverAccept(serverSocket);
+    if (acceptedSocket >= 0) {
+        ethernet.clientStop(acceptedSocket);
+    }
+    ethernet.clientSetAsyncConnect(false);
+    ethernet.clientSetConnectionTimeout(0);
+}
+
+// 1000 datagrams to "localhost" resolve the name once, an unknown name is looked up once
+// per negative TTL however often it is used
+static void testEthernetWrapperDnsCache()
+{
+    const unsigned int port = 5012;
+    const long datagrams = 1000;
+
+    EthernetWrapper ethernet;
+    int socket = -1;
+    if (ethernet.udpBegin(port + 1, &socket) != 1) {
+        Serial.println("EthernetWrapper DNS cache: cannot open the socket");
+        return;
+    }
+
+    unsigned char datagram[16];
+    memset(datagram, 'x', sizeof(datagram));
+    LARGE_INTEGER frequency, start, stop;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    for (long i = 0; i < datagrams; i++) {
+        ethernet.udpBeginPacket(socket, "localhost", port);
+        ethernet.udpWrite(socket, datagram, sizeof(datagram));
+        ethernet.udpEndPacket(socket);
+    }
+    QueryPerformanceCounter(&stop);
+    int unknown = 0;
+    for (int i = 0; i < 10; i++) {
+        unknown += ethernet.udpBeginPacket(socket, "no-such-host.invalid", port);
+    }
+
+    Serial.print("EthernetWrapper DNS cache: ");
+    Serial.print((double)(stop.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart / datagrams);
+    Serial.print(" us per datagram to localhost, ");
+    Serial.print(unknown);
+    Serial.print(" unknown names resolved, ");
+    Serial.print(ethernet.dnsCacheHits());
+    Serial.print(" hits, ");
+    Serial.print(ethernet.dnsCacheMisses());
+    Serial.println(" misses");
+
+    ethernet.udpClose(socket);
+}
+
+// 500 clients of a second EthernetWrapper connect, are accepted and stop one after another,
+// then 16 stay connected to a server with 8 client sockets: 8 must be accepted, 8 reset
+static void testEthernetWrapperAcceptStorm()
+{
+    const unsigned int port = 5014;
+    const long reconnects = 500;
+    const int clients = 16;
+
+    EthernetWrapper server;
+    EthernetWrapper peers;
+    peers.init(clients, 1, 1);
+    int serverSocket = -1;
+    server.serverSetBacklog(clients);
+    if (server.serverBegin("127.0.0.1", port, &serverSocket) != 1) {
+        Serial.println("EthernetWrapper accept storm: cannot listen");
+        return;
+    }
+
+    long accepted = 0;
+    LARGE_INTEGER frequency, start, stop;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    for (long i = 0; i < reconnects; i++) {
+        int peerSocket = -1;
+        int acceptedSocket = -1;
+        peers.clientConnect("127.0.0.1", port, &peerSocket);
+        for (int polls = 0; polls < 1000 && acceptedSocket < 0; polls++) {
+            acceptedSocket = server.serverAccept(serverSocket);
+            if (acceptedSocket < 0) {
+                Sleep(0);
+            }
+        }
+        if (acceptedSocket >= 0) {
+            accepted++;
+            server.clientStop(acceptedSocket);
+        }
+        peers.clientStop(peerSocket);
+    }
+    QueryPerformanceCounter(&stop);
+
+    Serial.print("EthernetWrapper accept storm: ");
+    Serial.print((unsigned long)(accepted * (double)frequency.QuadPart / (stop.QuadPart - start.QuadPart)));
+    Serial.print(" connect+accept+stop/s, ");
+    Serial.print(accepted);
+    Serial.print(" of ");
+    Serial.print(reconnects);
+    Serial.println(" accepted");
+
+    int peerSockets[clients];
+    for (int i = 0; i < clients; i++) {
+        peers.clientConnect("127.0.0.1", port, &peerSockets[i]);
+    }
+    unsigned long before = server.serverAcceptedClients(serverSocket);
+    for (int polls = 0; polls < 1000 && server.serverAcceptedClients(serverSocket) - before
+        + server.serverRejectedClients(serverSocket) < (unsigned long)clients; polls++) {
+        Sleep(1);
+    }
+
+    Serial.print("EthernetWrapper accept storm: ");
+    Serial.print(server.serverAcceptedClients(serverSocket) - before);
+    Serial.print(" accepted, ");
+    Serial.print(server.serverRejectedClients(serverSocket));
+    Serial.print(" rejected of ");
+    Serial.print(clients);
+    Serial.println(" with 8 client sockets");
+
+    for (int acceptedSocket = server.serverAccept(serverSocket); acceptedSocket >= 0;
+        acceptedSocket = server.serverAccept(serverSocket)) {
+        server.clientStop(acceptedSocket);
+    }
+    for (int i = 0; i < clients; i++) {
+        peers.clientStop(peerSockets[i]);
+    }
+}
@@ -0,0 +1,169 @@
+// Development tests of GPIOWrapper on the simulated GPIO, needs no IO-Warrior.
+// testGPIOWrapperToggle() uses an IO-Warrior with VM_TEST_GPIO_SERIAL=<serial number>.
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <stdlib.h>
+#include <atomic>
+#include <GPIOWrapper.h>
+#include <SimulatedGpio.h>
+#include <MonotonicClock.h>
+
+// Bit-bangs bytes on pins 2 (clock) and 3 (data), once with a write per pin change and
+// once with a transaction per clock edge, then one port write per byte
+static void testGPIOWrapperBitBang()
+{
+    const long bytes = 100000;
+
+    GPIOWrapper gpio;
+    gpio.begin("SIMULATED");
+    SimulatedGpio& simulated = SimulatedGpio::instance();
+    for (unsigned char pin = 0; pin < 8; pin++) {
+        gpio.pinMode(pin, OUTPUT);
+    }
+
+    unsigned long long reports = simulated.outputReports();
+    MonotonicClock perPin;
+    for (long i = 0; i < bytes; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            gpio.digitalWrite(3, (i >> bit) & 1);
+            gpio.digitalWrite(2, HIGH);
+            gpio.digitalWrite(2, LOW);
+        }
+    }
+    unsigned long micros = perPin.micros();
+    Serial.print("GPIOWrapper per pin: ");
+    Serial.print((unsigned long)(bytes * 1000000.0 / micros));
+    Serial.print(" bytes/s, ");
+    Serial.print((unsigned long)(simulated.outputReports() - reports));
+    Serial.println(" output reports");
+
+    reports = simulated.outputReports();
+    MonotonicClock transactions;
+    for (long i = 0; i < bytes; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            gpio.beginTransaction();
+            gpio.digitalWrite(3, (i >> bit) & 1);
+            gpio.digitalWrite(2, HIGH);
+            gpio.commitTransaction();
+            gpio.digitalWrite(2, LOW);
+        }
+    }
+    micros = transactions.micros();
+    Serial.print("GPIOWrapper transactions: ");
+    Serial.print((unsigned long)(bytes * 1000000.0 / micros));
+    Serial.print(" bytes/s, ");
+    Serial.print((unsigned long)(simulated.outputReports() - reports));
+    Serial.println(" output reports");
+
+    long errors = 0;
+    MonotonicClock ports;
+    for (long i = 0; i < bytes; i++) {
+        gpio.digitalWritePort(4, (unsigned char)i);
+        if (gpio.digitalReadPort(4) != (unsigned char)i || gpio.digitalReadMask(0xff) != (unsigned char)i) {
+            errors++;
+        }
+    }
+    micros = ports.micros();
+    Serial.print("GPIOWrapper port D: ");
+    Serial.print((unsigned long)(bytes * 1000000.0 / micros));
+    Serial.print(" write+read/s, ");
+    Serial.print(errors);
+    Serial.println(" errors");
+
+    gpio.end();
+}
+
+// One million toggles of pin 13, then one million writes of the level it already has,
+// which the shadow of the outputs skips without calling GPIONet
+static void testGPIOWrapperToggle()
+{
+    const long toggles = 1000000;
+
+    const char* serial = getenv("VM_TEST_GPIO_SERIAL");
+    GPIOWrapper gpio;
+    gpio.begin(serial != NULL ? serial : "SIMULATED");
+    gpio.pinMode(13, OUTPUT);
+
+    MonotonicClock toggling;
+    for (long i = 0; i < toggles; i++) {
+        gpio.digitalWrite(13, (unsigned char)(i & 1));
+    }
+    unsigned long micros = toggling.micros();
+    Serial.print("GPIOWrapper toggle: ");
+    Serial.print((unsigned long)(toggles * 1000000.0 / micros));
+    Serial.println(" writes/s");
+
+    MonotonicClock redundant;
+    for (long i = 0; i < toggles; i++) {
+        gpio.digitalWrite(13, HIGH);
+    }
+    micros = redundant.micros();
+    Serial.print("GPIOWrapper same level: ");
+    Serial.print((unsigned long)(toggles * 1000000.0 / (micros > 0 ? micros : 1)));
+    Serial.println(" writes/s");
+
+    gpio.end();
+}
+
+static std::atomic<long> gpioInterrupts(0);
+static std::atomic<long> gpioInterruptDisorders(0);
+static unsigned long long gpioLastInterruptMicros = 0;
+static GPIOWrapper* gpioInterruptWrapper = NULL;
+
+static void gpioRisingEdge()
+{
+    unsigned long long micros = gpioInterruptWrapper->interruptMicros();
+    if (micros < gpioLastInterruptMicros) {
+        gpioInterruptDisorders++;
+    }
+    gpioLastInterruptMicros = micros;
+    gpioInterrupts++;
+}
+
+// Rising edges driven into pin 2 by the test bench, each waits for its handler
+static void testGPIOWrapperInterrupts()
+{
+    const long edges = 100000;
+
+    GPIOWrapper gpio;
+    gpio.begin("SIMULATED");
+    gpioInterruptWrapper = &gpio;
+    SimulatedGpio& simulated = SimulatedGpio::instance();
+    gpio.pinMode(2, INPUT);
+    simulated.setInput(2, false);
+    gpio.attachInterrupt(2, gpioRisingEdge, RISING);
+
+    long timeouts = 0;
+    MonotonicClock clock;
+    for (long i = 0; i < edges; i++) {
+        simulated.setInput(2, true);
+        MonotonicClock waiting;
+        while (gpioInterrupts.load() <= i && waiting.millis() < 1000) {
+        }
+        if (gpioInterrupts.load() <= i) {
+            timeouts++;
+        }
+        simulated.setInput(2, false);
+    }
+    unsigned long micros = clock.micros();
+
+    Serial.print("GPIOWrapper interrupts: ");
+    Serial.print(gpioInterrupts.load());
+    Serial.print(" of ");
+    Serial.print(edges);
+    Serial.print(" edges, ");
+    Serial.print(micros / (double)edges);
+    Serial.print(" us per edge and handler, ");
+    Serial.print(gpioInterruptDisorders.load() + timeouts + (long)simulated.droppedInterrupts());
+    Serial.println(" errors");
+
+    gpio.detachInterrupt(2);
+    gpio.end();
+}
@@ -0,0 +1,41 @@
+// Development tests of ProcessSynchronizationWrapper, start several instances of this sketch
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <ProcessSynchronizationWrapper.h>
+#include <MonotonicClock.h>
+
+// Node loop of 100 us work and wait(1) for 10 seconds. With the same VM_SYNC_LANE the
+// instances take turns, with different lanes they run in parallel and loop more often.
+static void testNodeSchedulerThroughput()
+{
+    ProcessSynchronizationWrapper synchronization;
+    MonotonicClock clock;
+    long loops = 0;
+
+    while (clock.millis() < 10000) {
+        MonotonicClock work;
+        while (work.micros() < 100) {
+        }
+        synchronization.wait(1);
+        loops++;
+    }
+
+    unsigned long turns, averageMicros, maxMicros;
+    synchronization.schedulingLatency(&turns, &averageMicros, &maxMicros);
+    Serial.print("NodeScheduler: ");
+    Serial.print(loops);
+    Serial.print(" loops in 10 s, latency average ");
+    Serial.print(averageMicros);
+    Serial.print(" us, max ");
+    Serial.print(maxMicros);
+    Serial.print(" us over ");
+    Serial.print(turns);
+    Serial.println(" turns");
+}
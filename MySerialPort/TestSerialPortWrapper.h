@@ -0,0 +1,137 @@
+// Development tests of the native SerialPortWrapper backend (VM_SERIAL_NATIVE) against an openpty() pair.
+// POSIX only, the sketch itself does not build there. Run it without the sketch, from the repository root:
+//   g++ -std=c++17 -pthread -DVM_SERIAL_NATIVE -DTEST_SERIAL_PORT_WRAPPER_MAIN -I VirtualHardwareWrapper
+//       -x c++ MySerialPort/TestSerialPortWrapper.h -x none VirtualHardwareWrapper/SerialPortWrapperNative.cpp -lutil
+
+#pragma once
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <thread>
+#include <SerialPortWrapper.h>
+
+static int serialPtyFailures = 0;
+
+static void serialPtyCheck(bool ok, const char* what)
+{
+    printf("SerialPortWrapper pty: %s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        serialPtyFailures++;
+    }
+}
+
+static long serialPtyMillis()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Waits up to 1 s until the master side has something to read
+static bool serialPtyReadable(int fd)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 1000) == 1;
+}
+
+// Read, peek, partial and timed writes over a raw pty, the slave side is the serial port.
+// Returns the number of failed checks.
+static int testSerialPortWrapperPty()
+{
+    serialPtyFailures = 0;
+    int master, slave;
+    char name[128];
+    struct termios raw;
+    memset(&raw, 0, sizeof(raw));
+    cfmakeraw(&raw);
+    if (openpty(&master, &slave, name, &raw, NULL) != 0) {
+        serialPtyCheck(false, "openpty()");
+        return serialPtyFailures;
+    }
+
+    SerialPortWrapper port;
+    serialPtyCheck(port.setRxBufferSize(100) == 128, "rx buffer size rounded up to 128");
+    port.begin(name, 115200, 0x06);
+    serialPtyCheck(port.available() == 0 && port.peek() == -1, "nothing available after begin()");
+
+    // read and peek
+    serialPtyCheck(write(master, "hello", 5) == 5, "master writes 5 bytes");
+    for (int i = 0; i < 1000 && port.available() < 5; i++) {
+        usleep(1000);
+    }
+    serialPtyCheck(port.available() == 5, "available() is 5");
+    serialPtyCheck(port.peek() == 'h' && port.available() == 5, "peek() does not consume");
+    unsigned char buffer[64];
+    serialPtyCheck(port.read(buffer, 3) == 3 && memcmp(buffer, "hel", 3) == 0, "read of 3 bytes");
+    serialPtyCheck(port.read(buffer, sizeof(buffer)) == 2 && memcmp(buffer, "lo", 2) == 0, "read of the rest");
+    serialPtyCheck(port.read(buffer, 1) == -1, "read() of nothing is -1");
+
+    // write
+    serialPtyCheck(port.write((const unsigned char*)"world", 5) == 5, "write of 5 bytes");
+    char answer[16];
+    ssize_t count = serialPtyReadable(master) ? read(master, answer, sizeof(answer)) : 0;
+    serialPtyCheck(count == 5 && memcmp(answer, "world", 5) == 0, "master reads them");
+
+    // partial write, nobody reads the master side: timeout 0 returns what fits at once
+    static unsigned char big[1 << 20];
+    memset(big, 'x', sizeof(big));
+    long start = serialPtyMillis();
+    unsigned int written = port.write(big, sizeof(big));
+    long elapsed = serialPtyMillis() - start;
+    printf("SerialPortWrapper pty: %u of %u bytes fit, %ld ms\n", written, (unsigned int)sizeof(big), elapsed);
+    serialPtyCheck(written > 0 && written < sizeof(big) && elapsed < 100, "timeout 0 writes what fits and returns");
+
+    // timed write, the queue is still full: waits for the timeout and returns
+    port.setWriteTimeout(200);
+    start = serialPtyMillis();
+    written = port.write(big, sizeof(big));
+    elapsed = serialPtyMillis() - start;
+    printf("SerialPortWrapper pty: %u bytes in %ld ms with timeout 200 ms\n", written, elapsed);
+    serialPtyCheck(written < sizeof(big) && elapsed >= 190 && elapsed < 1000, "timed write waits for the timeout");
+
+    // timed write with a reader thread: everything goes out
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    while (read(master, big, sizeof(big)) > 0) {
+    }
+    const unsigned int length = 65536;
+    long drained = 0;
+    std::thread reader([master, &drained, length]() {
+        unsigned char chunk[4096];
+        while (drained < (long)length && serialPtyReadable(master)) {
+            ssize_t n = read(master, chunk, sizeof(chunk));
+            drained += n > 0 ? n : 0;
+        }
+    });
+    port.setWriteTimeout(2000);
+    written = port.write(big, length);
+    reader.join();
+    serialPtyCheck(written == length && drained == (long)length, "timed write with a reader sends everything");
+
+    port.end();
+    serialPtyCheck(port.available() == 0 && port.peek() == -1, "nothing available after end()");
+
+    close(master);
+    close(slave);
+    printf("SerialPortWrapper pty: %d failures\n", serialPtyFailures);
+    return serialPtyFailures;
+}
+
+#ifdef TEST_SERIAL_PORT_WRAPPER_MAIN
+int main()
+{
+    return testSerialPortWrapperPty() == 0 ? 0 : 1;
+}
+#endif
+
+#endif // _WIN32
@@ -0,0 +1,152 @@
+// Development tests of TimingWrapper and its MonotonicClock
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <TimingWrapper.h>
+#include <MonotonicClock.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cost of one millis() and one micros() call
+static void testTimingWrapperCost()
+{
+    const long calls = 10000000;
+
+    TimingWrapper timing;
+    MonotonicClock stopwatch;
+    unsigned int sum = 0;
+
+    unsigned long long start = stopwatch.ticks();
+    for (long i = 0; i < calls; i++) {
+        sum += timing.millis();
+    }
+    unsigned long long millisTicks = stopwatch.ticks() - start;
+
+    start = stopwatch.ticks();
+    for (long i = 0; i < calls; i++) {
+        sum += timing.micros();
+    }
+    unsigned long long microsTicks = stopwatch.ticks() - start;
+
+    Serial.print("TimingWrapper cost: millis() ");
+    Serial.print((double)millisTicks * 1e9 / stopwatch.frequency() / calls);
+    Serial.print(" ns, micros() ");
+    Serial.print((double)microsTicks * 1e9 / stopwatch.frequency() / calls);
+    Serial.print(" ns per call (");
+    Serial.print(sum & 1);
+    Serial.println(")");
+}
+
+// Walks the tick to time conversion through 24 hours of simulated time in uneven steps
+// for the common counter frequencies, then across the 49.7 day wraparound of millis().
+// Returns the number of failed checks.
+static long testMonotonicClockDrift()
+{
+    const unsigned long long frequencies[] = { 10000000ULL, 3579545ULL, 2400000017ULL, 1000000000ULL };
+    const unsigned long long hours = 24;
+    long failures = 0;
+
+    for (unsigned int f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++) {
+        const unsigned long long frequency = frequencies[f];
+        const unsigned long long end = hours * 3600 * frequency;
+        // about 0.9 ms, not a divisor of the frequency, so the steps fall between whole micros
+        const unsigned long long step = frequency / 1111 + 7;
+
+        unsigned int lastMicros = 0;
+        unsigned int lastMillis = 0;
+        unsigned long long nextSecond = frequency;
+        unsigned long long second = 1;
+        for (unsigned long long ticks = step; ticks <= end; ticks += step) {
+            unsigned int micros = MonotonicClock::toMicros(ticks, frequency);
+            unsigned int millis = MonotonicClock::toMillis(ticks, frequency);
+
+            // monotonic modulo 2^32, and never more than one step ahead
+            unsigned int deltaMicros = micros - lastMicros;
+            if (deltaMicros > step * 1000000 / frequency + 1) {
+                failures++;
+            }
+            if (millis - lastMillis > 1) {
+                failures++;
+            }
+            lastMicros = micros;
+            lastMillis = millis;
+
+            // exact at every whole second, however many steps came before
+            if (ticks >= nextSecond) {
+                if (MonotonicClock::toMicros(nextSecond, frequency) != (unsigned int)(second * 1000000)
+                    || MonotonicClock::toMillis(nextSecond, frequency) != (unsigned int)(second * 1000)) {
+                    failures++;
+                }
+                nextSecond += frequency;
+                second++;
+            }
+        }
+
+        // millis() wraps to 0 after 2^32 ms like on an Arduino, micros() after 2^32 us
+        // first tick of the 2^32-th unit, rounded up
+        const unsigned long long millisWrap = ((1ULL << 32) * frequency + 999) / 1000;
+        const unsigned long long microsWrap = ((1ULL << 32) * frequency + 999999) / 1000000;
+        if (MonotonicClock::toMillis(millisWrap - 1, frequency) != 0xFFFFFFFF
+            || MonotonicClock::toMillis(millisWrap, frequency) != 0
+            || MonotonicClock::toMicros(microsWrap - 1, frequency) != 0xFFFFFFFF
+            || MonotonicClock::toMicros(microsWrap, frequency) != 0) {
+            failures++;
+        }
+    }
+
+    Serial.print("MonotonicClock drift: ");
+    Serial.print(hours);
+    Serial.print(" simulated hours at ");
+    Serial.print((unsigned long)(sizeof(frequencies) / sizeof(frequencies[0])));
+    Serial.print(" frequencies, ");
+    Serial.print(failures);
+    Serial.println(" failures");
+    return failures;
+}
+
+// 24 hours of a sensor node sleeping between irregular measurements, for the virtual time mode.
+// Run it on one or several boards with VM_VIRTUAL_TIME=<boards>: it must finish in seconds
+// and print the same checksum on every run.
+static unsigned int testVirtualTimeDay()
+{
+    const char* virtualTime = getenv("VM_VIRTUAL_TIME");
+    if (virtualTime == NULL || *virtualTime == '\0' || strcmp(virtualTime, "0") == 0) {
+        Serial.println("VirtualTime day: VM_VIRTUAL_TIME not set, skipped");
+        return 0;
+    }
+
+    const unsigned long long day = 24ULL * 3600 * 1000;
+
+    TimingWrapper timing;
+    MonotonicClock stopwatch;
+    unsigned long long elapsed = 0;
+    unsigned int lastMillis = timing.millis();
+    unsigned int checksum = 2166136261u; // FNV-1a
+    unsigned int random = 12345;
+    long measurements = 0;
+
+    while (elapsed < day) {
+        random = random * 1103515245u + 12345u;
+        timing.delay(1 + (random >> 16) % 60000);
+
+        unsigned int now = timing.millis();
+        elapsed += now - lastMillis;
+        lastMillis = now;
+        checksum = (checksum ^ timing.micros()) * 16777619u;
+        measurements++;
+    }
+
+    Serial.print("VirtualTime day: ");
+    Serial.print(measurements);
+    Serial.print(" measurements in ");
+    Serial.print((double)stopwatch.ticks() / stopwatch.frequency());
+    Serial.print(" s, checksum ");
+    Serial.println(checksum);
+    return checksum;
+}
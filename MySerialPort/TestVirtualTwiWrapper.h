@@ -0,0 +1,235 @@
+// Development tests of VirtualTwiWrapper over VirtualTwiServer, or with VM_TWI_TRANSPORT=shm or local over a native bus.
+// Instances with VM_TEST_TWI_SLAVE=<n> are echo slaves at address 0x20 + n, one instance without
+// it is the master and uses VM_TEST_TWI_SLAVES=<count> slaves (default 1).
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#include <crtdbg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <VirtualTwiWrapper.h>
+#include <TwiLocalBus.h>
+#include <MonotonicClock.h>
+
+#pragma comment(lib, "psapi.lib")
+
+static VirtualTwiWrapper* twiEchoWrapper = NULL;
+static unsigned char twiEchoData[32];
+static int twiEchoLength = 0;
+
+static void twiEchoReceive(unsigned char* buffer, int quantity)
+{
+    twiEchoLength = quantity < (int)sizeof(twiEchoData) ? quantity : (int)sizeof(twiEchoData);
+    memcpy(twiEchoData, buffer, twiEchoLength);
+}
+
+static void twiEchoTransmit()
+{
+    twiEchoWrapper->transmit(twiEchoData, twiEchoLength);
+}
+
+static volatile long twiSoakFrames = 0;
+static volatile long twiSoakBadFrames = 0;
+
+static void twiSoakReceive(unsigned char* buffer, int quantity)
+{
+    if (quantity != 1 + twiSoakFrames % 32 || buffer[0] != (unsigned char)twiSoakFrames) {
+        twiSoakBadFrames++;
+    }
+    twiSoakFrames++;
+}
+
+static size_t twiPrivateBytes()
+{
+    PROCESS_MEMORY_COUNTERS_EX counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+    return counters.PrivateUsage;
+}
+
+// A master and a slave in this process, 100000 frames of 1 to 32 bytes to the slave must not
+// grow the heap. Debug builds also count the heap blocks still allocated afterwards.
+static void testVirtualTwiWrapperRxSoak()
+{
+    const long frames = 100000;
+    const unsigned char address = 0x7f;
+
+    if (getenv("VM_TEST_TWI_SLAVE") != NULL) {
+        return;
+    }
+
+    VirtualTwiWrapper slave;
+    slave.attachSlaveRxEvent(twiSoakReceive);
+    slave.setAddress(address);
+    slave.begin();
+    VirtualTwiWrapper master;
+    master.begin();
+
+    unsigned char frame[32];
+    // warm up, the first frames allocate the buffers of the transport
+    for (long i = 0; i < 100; i++) {
+        frame[0] = (unsigned char)i;
+        master.writeTo(address, frame, (unsigned char)(1 + i % 32), 1, 1);
+    }
+    for (int i = 0; i < 5000 && twiSoakFrames < 100; i++) {
+        Sleep(1);
+    }
+
+#ifdef _DEBUG
+    _CrtMemState heapBefore, heapAfter, heapDifference;
+    _CrtMemCheckpoint(&heapBefore);
+#endif
+    size_t before = twiPrivateBytes();
+
+    for (long i = 100; i < 100 + frames; i++) {
+        frame[0] = (unsigned char)i;
+        master.writeTo(address, frame, (unsigned char)(1 + i % 32), 1, 1);
+    }
+    for (int i = 0; i < 5000 && twiSoakFrames < 100 + frames; i++) {
+        Sleep(1);
+    }
+
+    size_t after = twiPrivateBytes();
+    Serial.print("VirtualTwiWrapper rx soak: ");
+    Serial.print(twiSoakFrames - 100);
+    Serial.print(" of ");
+    Serial.print(frames);
+    Serial.print(" frames, ");
+    Serial.print(twiSoakBadFrames);
+    Serial.print(" bad, private bytes ");
+    Serial.print((unsigned long)before);
+    Serial.print(" -> ");
+    Serial.println((unsigned long)after);
+#ifdef _DEBUG
+    _CrtMemCheckpoint(&heapAfter);
+    _CrtMemDifference(&heapDifference, &heapBefore, &heapAfter);
+    Serial.print("VirtualTwiWrapper rx soak: ");
+    Serial.print(heapDifference.lCounts[_NORMAL_BLOCK]);
+    Serial.println(" heap blocks left allocated");
+#endif
+
+    master.end();
+    slave.end();
+}
+
+// An I2C chip model on the in-process bus, answers with the last bytes written to it
+class TwiEchoModel : public TwiDevice
+{
+public: unsigned char data[32];
+public: unsigned int length;
+
+public: TwiEchoModel()
+        : length(0)
+    {
+    }
+
+public: virtual void onReceive(const unsigned char* buffer, unsigned int quantity)
+    {
+        length = quantity < sizeof(data) ? quantity : sizeof(data);
+        memcpy(data, buffer, length);
+    }
+
+public: virtual unsigned int onRequest(unsigned char* buffer, unsigned int quantity)
+    {
+        unsigned int count = quantity < length ? quantity : length;
+        memcpy(buffer, data, count);
+        return count;
+    }
+};
+
+// Two master boards as threads of this process, each with its own model on TwiLocalBus
+static void testTwiLocalBusTransactions()
+{
+    const long transactions = 1000000;
+
+    TwiEchoModel models[2];
+    TwiLocalBus slaves[2];
+    slaves[0].begin(0x50, &models[0]);
+    slaves[1].begin(0x51, &models[1]);
+
+    std::atomic<long> errors(0);
+    MonotonicClock clock;
+    std::thread boards[2];
+    for (int board = 0; board < 2; board++) {
+        boards[board] = std::thread([board, &errors]() {
+            TwiLocalBus master;
+            master.begin(0, NULL);
+            unsigned char address = (unsigned char)(0x50 + board);
+            unsigned char tx[4] = { 1, 2, 3, 4 };
+            unsigned char rx[4];
+            for (long i = 0; i < transactions; i++) {
+                tx[0] = (unsigned char)i;
+                if (master.writeTo(address, tx, sizeof(tx)) != 0
+                    || master.readFrom(address, rx, sizeof(rx)) != sizeof(rx) || rx[0] != tx[0]) {
+                    errors++;
+                }
+            }
+        });
+    }
+    boards[0].join();
+    boards[1].join();
+    unsigned long micros = clock.micros();
+
+    Serial.print("TwiLocalBus: ");
+    Serial.print((unsigned long)(2 * transactions * 1000000.0 / micros));
+    Serial.print(" write+read transactions/s with 2 boards, ");
+    Serial.print(errors.load());
+    Serial.println(" errors");
+}
+
+// Every transaction is a write of 4 bytes and a read of them back, round robin over the slaves
+static void testVirtualTwiWrapperTransactions()
+{
+    const char* slave = getenv("VM_TEST_TWI_SLAVE");
+    if (slave != NULL) {
+        twiEchoWrapper = new VirtualTwiWrapper();
+        twiEchoWrapper->attachSlaveRxEvent(twiEchoReceive);
+        twiEchoWrapper->attachSlaveTxEvent(twiEchoTransmit);
+        twiEchoWrapper->begin();
+        twiEchoWrapper->setAddress((unsigned char)(0x20 + atoi(slave)));
+        Serial.println("VirtualTwiWrapper: echo slave running");
+        for (;;) {
+            Sleep(1000);
+        }
+    }
+
+    const char* slaves = getenv("VM_TEST_TWI_SLAVES");
+    int slaveCount = slaves != NULL && atoi(slaves) > 0 ? atoi(slaves) : 1;
+    VirtualTwiWrapper twi;
+    twi.begin();
+
+    MonotonicClock clock;
+    long transactions = 0;
+    long errors = 0;
+    unsigned char tx[4] = { 1, 2, 3, 4 };
+    unsigned char rx[4];
+    while (clock.millis() < 10000) {
+        unsigned char address = (unsigned char)(0x20 + transactions % slaveCount);
+        tx[0] = (unsigned char)transactions;
+        if (twi.writeTo(address, tx, sizeof(tx), 1, 1) != 0) {
+            errors++;
+        }
+        if (twi.readFrom(address, rx, sizeof(rx), 1) != sizeof(rx) || rx[0] != tx[0]) {
+            errors++;
+        }
+        transactions++;
+    }
+
+    Serial.print("VirtualTwiWrapper: ");
+    Serial.print(transactions / 10);
+    Serial.print(" write+read transactions/s with ");
+    Serial.print(slaveCount);
+    Serial.print(" slaves, ");
+    Serial.print(errors);
+    Serial.println(" errors");
+}
@@ -12,6 +12,9 @@ namespace TestVirtualHardwareNet
     {
         private TestFastIow testFastIow = new TestFastIow();
         private TestUdp testUdp = new TestUdp();
+        private TestSerialPort testSerialPort = new TestSerialPort();
+        private TestByteQueue testByteQueue = new TestByteQueue();
+        private TestEthernet testEthernet = new TestEthernet();
 
         static void Main(string[] args)
         {
@@ -32,18 +35,27 @@ namespace TestVirtualHardwareNet
         {
             testFastIow.End();
             //testUdp.End();
+            //testSerialPort.End();
+            //testByteQueue.End();
+            //testEthernet.End();
         }
 
         public void Setup()
         {
             testFastIow.Setup();
             //testUdp.Setup();
+            //testSerialPort.Setup();
+            //testByteQueue.Setup();
+            //testEthernet.Setup();
         }
 
         public void Loop()
         {
             testFastIow.Loop();
             //testUdp.Loop();
+            //testSerialPort.Loop();
+            //testByteQueue.Loop();
+            //testEthernet.Loop();
         }
     }
 }
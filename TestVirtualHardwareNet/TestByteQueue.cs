@@ -0,0 +1,128 @@
+﻿using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using VirtualHardwareNet;
+
+namespace TestVirtualHardwareNet
+{
+    /// <summary>
+    /// Compares the locked ByteQueue with the lock-free SpscByteQueue between one producer
+    /// and one consumer thread, paced at a fixed data rate like a serial or socket worker.
+    /// </summary>
+    public class TestByteQueue
+    {
+        private const int Capacity = 4096;
+        private const int ChunkSize = 64;
+        private const int DurationMillis = 2000;
+
+        private interface IQueue
+        {
+            int Length { get; }
+            int Enqueue(byte[] buffer, int size);
+            int Dequeue(byte[] buffer, int size);
+        }
+
+        private class LockedQueue : IQueue
+        {
+            private ByteQueue _queue = new ByteQueue();
+            public int Length { get { return _queue.Length; } }
+            public int Enqueue(byte[] buffer, int size)
+            {
+                // the workers bound ByteQueue by checking its length first
+                size = Math.Min(size, Capacity - _queue.Length);
+                _queue.Enqueue(buffer, 0, size);
+                return size;
+            }
+            public int Dequeue(byte[] buffer, int size) { return _queue.Dequeue(buffer, 0, size); }
+        }
+
+        private class LockFreeQueue : IQueue
+        {
+            private SpscByteQueue _queue = new SpscByteQueue(Capacity);
+            public int Length { get { return _queue.Length; } }
+            public int Enqueue(byte[] buffer, int size) { return _queue.Enqueue(buffer, 0, size); }
+            public int Dequeue(byte[] buffer, int size) { return _queue.Dequeue(buffer, 0, size); }
+        }
+
+        public void Setup()
+        {
+        }
+
+        public void Loop()
+        {
+            foreach (long rate in new long[] { 1000000, 100000000 }) {
+                measure("ByteQueue    ", new LockedQueue(), rate);
+                measure("SpscByteQueue", new LockFreeQueue(), rate);
+            }
+            Console.WriteLine();
+        }
+
+        public void End()
+        {
+        }
+
+        private void measure(string name, IQueue queue, long bytesPerSecond)
+        {
+            long produced = 0;
+            long consumed = 0;
+            long enqueueTicks = 0;
+            long dequeueTicks = 0;
+            long enqueueCalls = 0;
+            long dequeueCalls = 0;
+            bool producerDone = false;
+            var stopwatch = Stopwatch.StartNew();
+
+            var producer = new Thread(() => {
+                byte[] chunk = new byte[ChunkSize];
+                while (stopwatch.ElapsedMilliseconds < DurationMillis) {
+                    long due = bytesPerSecond * stopwatch.ElapsedTicks / Stopwatch.Frequency;
+                    if (produced >= due) {
+                        Thread.Yield();
+                        continue;
+                    }
+                    long start = Stopwatch.GetTimestamp();
+                    produced += queue.Enqueue(chunk, chunk.Length);
+                    enqueueTicks += Stopwatch.GetTimestamp() - start;
+                    enqueueCalls++;
+                }
+                Volatile.Write(ref producerDone, true);
+            });
+
+            var consumer = new Thread(() => {
+                byte[] buffer = new byte[ChunkSize * 4];
+                while (!Volatile.Read(ref producerDone) || queue.Length > 0) {
+                    long start = Stopwatch.GetTimestamp();
+                    int count = queue.Dequeue(buffer, buffer.Length);
+                    if (count == 0) {
+                        Thread.Yield();
+                        continue;
+                    }
+                    dequeueTicks += Stopwatch.GetTimestamp() - start;
+                    dequeueCalls++;
+                    consumed += count;
+                }
+            });
+
+            producer.Start();
+            consumer.Start();
+            producer.Join();
+            consumer.Join();
+
+            double seconds = stopwatch.Elapsed.TotalSeconds;
+            Console.WriteLine("{0} @ {1,5} MB/s: {2,8:F2} MB/s moved, enqueue {3,6:F0} ns, dequeue {4,6:F0} ns{5}",
+                name, bytesPerSecond / 1000000, consumed / seconds / 1000000,
+                nanos(enqueueTicks, enqueueCalls), nanos(dequeueTicks, dequeueCalls),
+                produced == consumed ? "" : " LOST DATA");
+        }
+
+        private static double nanos(long ticks, long calls)
+        {
+            return calls == 0 ? 0 : ticks * 1e9 / Stopwatch.Frequency / calls;
+        }
+    }
+}
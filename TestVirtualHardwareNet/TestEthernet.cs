@@ -0,0 +1,172 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Net;
+using System.Net.Sockets;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using VirtualHardwareNet;
+
+namespace TestVirtualHardwareNet
+{
+    /// <summary>
+    /// Echo round trip of many TCP peers through one EthernetServer, like a MySensors gateway.
+    /// The peers are plain TcpClients on this machine, the sketch side polls like loop() does.
+    /// Also opens and closes 10k client connections in batches of ConcurrentConnections.
+    /// </summary>
+    public class TestEthernet
+    {
+        private const ushort ServerPort = 5003;
+        private const ushort ConnectPort = 5004;
+        private const int PeerCount = 64;
+        private const int Rounds = 1000;
+        private const int MessageSize = 32;
+        private const int ConnectCycles = 10000;
+        private const int ConcurrentConnections = 250;
+
+        private EthernetNet _ethernet = new EthernetNet();
+        private int _serverSocket = -1;
+        private List<int> _sketchSockets = new List<int>();
+        private List<TcpClient> _peers = new List<TcpClient>();
+
+        public void Setup()
+        {
+            _ethernet.init(PeerCount + ConcurrentConnections, 2, 8);
+            _ethernet.serverBegin("127.0.0.1", ServerPort, ref _serverSocket);
+
+            for (int i = 0; i < PeerCount; i++) {
+                var peer = new TcpClient("127.0.0.1", ServerPort);
+                peer.NoDelay = true;
+                _peers.Add(peer);
+            }
+
+            var stopwatch = Stopwatch.StartNew();
+            while (_sketchSockets.Count < PeerCount && stopwatch.ElapsedMilliseconds < 5000) {
+                int socketNumber = _ethernet.serverAccept(_serverSocket);
+                if (socketNumber >= 0) {
+                    _sketchSockets.Add(socketNumber);
+                }
+            }
+            Console.WriteLine("{0} of {1} peers accepted, {2} threads in process",
+                _sketchSockets.Count, PeerCount, Process.GetCurrentProcess().Threads.Count);
+        }
+
+        public void Loop()
+        {
+            byte[] message = new byte[MessageSize];
+            byte[] echo = new byte[MessageSize];
+            byte[] buffer = new byte[MessageSize];
+            long totalTicks = 0;
+            long maxTicks = 0;
+
+            for (int round = 0; round < Rounds; round++) {
+                long start = Stopwatch.GetTimestamp();
+
+                foreach (var peer in _peers) {
+                    peer.GetStream().Write(message, 0, message.Length);
+                }
+
+                // sketch side: echo everything received
+                int echoed = 0;
+                while (echoed < PeerCount * MessageSize) {
+                    foreach (int socketNumber in _sketchSockets) {
+                        if (_ethernet.clientAvailable(socketNumber) > 0) {
+                            int count = _ethernet.clientRead(socketNumber, buffer, (ushort)buffer.Length);
+                            if (count > 0) {
+                                _ethernet.clientWrite(socketNumber, buffer, (ushort)count);
+                                echoed += count;
+                            }
+                        }
+                    }
+                }
+
+                foreach (var peer in _peers) {
+                    int received = 0;
+                    while (received < MessageSize) {
+                        received += peer.GetStream().Read(echo, received, MessageSize - received);
+                    }
+                }
+
+                long ticks = Stopwatch.GetTimestamp() - start;
+                totalTicks += ticks;
+                maxTicks = Math.Max(maxTicks, ticks);
+            }
+
+            Console.WriteLine("{0} peers echo round trip: {1,8:F3} ms average, {2,8:F3} ms max",
+                PeerCount, toMillis(totalTicks) / Rounds, toMillis(maxTicks));
+
+            measureConnectCycles();
+            Thread.Sleep(1000);
+        }
+
+        private void measureConnectCycles()
+        {
+            var listener = new TcpListener(IPAddress.Loopback, ConnectPort);
+            listener.Start(ConcurrentConnections);
+            var acceptThread = new Thread(() => {
+                try {
+                    while (true) {
+                        listener.AcceptTcpClient().Close();
+                    }
+                } catch (SocketException) {
+                    // listener stopped
+                }
+            });
+            acceptThread.Start();
+
+            var socketNumbers = new int[ConcurrentConnections];
+            int failed = 0;
+            long allocateTicks = 0;
+            var stopwatch = Stopwatch.StartNew();
+
+            for (int cycle = 0; cycle < ConnectCycles; cycle += ConcurrentConnections) {
+                for (int i = 0; i < ConcurrentConnections; i++) {
+                    if (_ethernet.clientConnect("127.0.0.1", ConnectPort, ref socketNumbers[i]) != 1) {
+                        failed++;
+                    }
+                }
+                // close() without the lingering FIN handshake of stop()
+                for (int i = 0; i < ConcurrentConnections; i++) {
+                    _ethernet.clientClose(socketNumbers[i]);
+                }
+            }
+            stopwatch.Stop();
+
+            // socket number allocation alone, without the TCP handshake
+            long start = Stopwatch.GetTimestamp();
+            for (int cycle = 0; cycle < ConnectCycles; cycle += ConcurrentConnections) {
+                for (int i = 0; i < ConcurrentConnections; i++) {
+                    _ethernet.NewClient(ref socketNumbers[i]);
+                }
+                for (int i = 0; i < ConcurrentConnections; i++) {
+                    _ethernet.clientClose(socketNumbers[i]);
+                }
+            }
+            allocateTicks = Stopwatch.GetTimestamp() - start;
+
+            listener.Stop();
+            acceptThread.Join();
+
+            Console.WriteLine("{0} connections, {1} at a time: {2,8:F3} ms per connect/close, {3} failed, {4,8:F3} us per socket allocate/release",
+                ConnectCycles, ConcurrentConnections, stopwatch.Elapsed.TotalMilliseconds / ConnectCycles, failed,
+                toMillis(allocateTicks) * 1000 / ConnectCycles);
+        }
+
+        public void End()
+        {
+            foreach (var peer in _peers) {
+                peer.Close();
+            }
+            foreach (int socketNumber in _sketchSockets) {
+                _ethernet.clientStop(socketNumber);
+            }
+        }
+
+        private static double toMillis(long ticks)
+        {
+            return ticks * 1000.0 / Stopwatch.Frequency;
+        }
+    }
+}
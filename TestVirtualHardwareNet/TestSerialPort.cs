@@ -0,0 +1,188 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using VirtualHardwareNet;
+
+namespace TestVirtualHardwareNet
+{
+    /// <summary>
+    /// Measures managed allocations per Serial.write()/Serial.read() call, echo latency and throughput.
+    /// Requires a serial loopback pair, e.g. a com0com virtual null-modem pair COM1 &lt;-&gt; COM2.
+    /// </summary>
+    public class TestSerialPort
+    {
+        private const string PortNameA = "COM1";
+        private const string PortNameB = "COM2";
+        private const int BaudRate = 921600;
+        private const int Iterations = 100000;
+        private const int EchoIterations = 1000;
+        private const int ThroughputBytes = 1 << 20;
+        private const int FrameSize = 4096;
+
+        private SerialPortNet _serialA = new SerialPortNet();
+        private SerialPortNet _serialB = new SerialPortNet();
+
+        public void Setup()
+        {
+            AppDomain.MonitoringIsEnabled = true;
+
+            _serialA.setRxBufferSize(4096);
+            _serialB.setRxBufferSize(4096);
+            _serialA.setTxBufferSize(1024);
+            _serialA.setWriteTimeout(1000);
+            _serialA.begin(PortNameA, BaudRate, 0);
+            _serialB.begin(PortNameB, BaudRate, 0);
+        }
+
+        public void Loop()
+        {
+            measure("byte[] copy path", transferArray);
+            measure("pointer path    ", transferPointer);
+            measureEcho();
+            measureThroughput();
+            measureFrame();
+            Thread.Sleep(1000);
+        }
+
+        public void End()
+        {
+            _serialA.end();
+            _serialB.end();
+        }
+
+        private void measure(string name, Action<int> transfer)
+        {
+            // warm up JIT and queues
+            transfer(1000);
+
+            GC.Collect();
+            long allocatedBefore = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize;
+            var stopwatch = Stopwatch.StartNew();
+
+            transfer(Iterations);
+
+            stopwatch.Stop();
+            long allocated = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize - allocatedBefore;
+
+            Console.WriteLine("{0}: {1,8:F2} bytes allocated/call, {2,8:F3} us/call",
+                name, (double)allocated / Iterations, stopwatch.Elapsed.TotalMilliseconds * 1000 / Iterations);
+        }
+
+        private void measureEcho()
+        {
+            long totalTicks = 0;
+            long maxTicks = 0;
+            for (int i = 0; i < EchoIterations; i++) {
+                long start = Stopwatch.GetTimestamp();
+                _serialA.write((byte)i);
+                int b;
+                while ((b = _serialB.read()) < 0) { }
+                _serialB.write((byte)b);
+                while (_serialA.read() < 0) { }
+                long ticks = Stopwatch.GetTimestamp() - start;
+                totalTicks += ticks;
+                maxTicks = Math.Max(maxTicks, ticks);
+            }
+
+            Console.WriteLine("echo round trip : {0,8:F3} ms average, {1,8:F3} ms max",
+                toMillis(totalTicks) / EchoIterations, toMillis(maxTicks));
+        }
+
+        private void measureThroughput()
+        {
+            byte[] txData = new byte[256];
+            byte[] rxData = new byte[4096];
+            int sent = 0;
+            int received = 0;
+            var stopwatch = Stopwatch.StartNew();
+
+            while (received < ThroughputBytes && stopwatch.ElapsedMilliseconds < 60000) {
+                if (sent < ThroughputBytes) {
+                    sent += (int)_serialA.write(txData, (uint)Math.Min(txData.Length, ThroughputBytes - sent));
+                }
+                int count = _serialB.read(ref rxData, (uint)rxData.Length);
+                if (count > 0) {
+                    received += count;
+                }
+            }
+
+            stopwatch.Stop();
+            double wireSpeed = BaudRate / 10.0;
+            double bytesPerSecond = received / stopwatch.Elapsed.TotalSeconds;
+            Console.WriteLine("throughput      : {0,8:F1} KB/s, {1,5:F1} % of {2} baud wire speed",
+                bytesPerSecond / 1000, 100 * bytesPerSecond / wireSpeed, BaudRate);
+        }
+
+        // A frame larger than the send buffer must stream through a blocking write without losing bytes
+        private void measureFrame()
+        {
+            byte[] frame = new byte[FrameSize];
+            byte[] rxData = new byte[FrameSize];
+            for (int i = 0; i < frame.Length; i++) {
+                frame[i] = (byte)i;
+            }
+
+            var reader = new Thread(() => {
+                byte[] chunk = new byte[FrameSize];
+                int received = 0;
+                var stopwatch = Stopwatch.StartNew();
+                while (received < FrameSize && stopwatch.ElapsedMilliseconds < 5000) {
+                    int count = _serialB.read(ref chunk, (uint)(FrameSize - received));
+                    if (count > 0) {
+                        Buffer.BlockCopy(chunk, 0, rxData, received, count);
+                        received += count;
+                    }
+                }
+            });
+            reader.Start();
+
+            uint sent = _serialA.write(frame, (uint)frame.Length);
+            reader.Join();
+
+            Console.WriteLine("4 KB frame      : {0} of {1} bytes accepted by one write(), {2}",
+                sent, frame.Length, frame.SequenceEqual(rxData) ? "received intact" : "DATA LOST");
+        }
+
+        private static double toMillis(long ticks)
+        {
+            return ticks * 1000.0 / Stopwatch.Frequency;
+        }
+
+        // Same managed transitions as SerialPortWrapper before the pointer overloads
+        private void transferArray(int count)
+        {
+            IntPtr native = Marshal.AllocHGlobal(1);
+            try {
+                for (int i = 0; i < count; i++) {
+                    Marshal.WriteByte(native, (byte)i);
+                    byte[] txData = new byte[1];
+                    Marshal.Copy(native, txData, 0, 1);
+                    _serialA.write(txData, 1);
+
+                    byte[] rxData = new byte[1];
+                    int result = _serialB.read(ref rxData, 1);
+                    if (result > 0) {
+                        Marshal.Copy(rxData, 0, native, result);
+                    }
+                }
+            } finally {
+                Marshal.FreeHGlobal(native);
+            }
+        }
+
+        private unsafe void transferPointer(int count)
+        {
+            byte b;
+            for (int i = 0; i < count; i++) {
+                b = (byte)i;
+                _serialA.write(&b, 1);
+                _serialB.read(&b, 1);
+            }
+        }
+    }
+}
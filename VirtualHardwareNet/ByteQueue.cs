@@ -163,6 +163,39 @@ namespace System.Collections
             }
         }
 
+        /// <summary>
+        /// Enqueues unmanaged memory to the queue without an intermediate managed buffer
+        /// </summary>
+        /// <param name="buffer">Pointer to the first byte to enqueue</param>
+        /// <param name="size">The number of bytes to enqueue</param>
+        internal unsafe void Enqueue(byte* buffer, int size)
+        {
+            if (size == 0)
+                return;
+
+            lock (this)
+            {
+                if ((fSize + size) > fInternalBuffer.Length)
+                    SetCapacity((fSize + size + 2047) & ~2047);
+
+                int rightLength = (fInternalBuffer.Length - fTail);
+
+                if (rightLength >= size)
+                {
+                    Marshal.Copy((IntPtr)buffer, fInternalBuffer, fTail, size);
+                }
+                else
+                {
+                    Marshal.Copy((IntPtr)buffer, fInternalBuffer, fTail, rightLength);
+                    Marshal.Copy((IntPtr)(buffer + rightLength), fInternalBuffer, 0, size - rightLength);
+                }
+
+                fTail = (fTail + size) % fInternalBuffer.Length;
+                fSize += size;
+                fSizeUntilCut = fInternalBuffer.Length - fHead;
+            }
+        }
+
         /// <summary>
         /// Dequeues a buffer from the queue
         /// </summary>
@@ -213,6 +246,48 @@ namespace System.Collections
             }
         }
 
+        /// <summary>
+        /// Dequeues from the queue directly into unmanaged memory
+        /// </summary>
+        /// <param name="buffer">Pointer to the destination memory</param>
+        /// <param name="size">The number of bytes to dequeue</param>
+        /// <returns>Number of bytes dequeued</returns>
+        internal unsafe int Dequeue(byte* buffer, int size)
+        {
+            if (size == 0)
+                return 0;
+
+            lock (this)
+            {
+                if (size > fSize)
+                    size = fSize;
+
+                int rightLength = (fInternalBuffer.Length - fHead);
+
+                if (rightLength >= size)
+                {
+                    Marshal.Copy(fInternalBuffer, fHead, (IntPtr)buffer, size);
+                }
+                else
+                {
+                    Marshal.Copy(fInternalBuffer, fHead, (IntPtr)buffer, rightLength);
+                    Marshal.Copy(fInternalBuffer, 0, (IntPtr)(buffer + rightLength), size - rightLength);
+                }
+
+                fHead = (fHead + size) % fInternalBuffer.Length;
+                fSize -= size;
+
+                if (fSize == 0)
+                {
+                    fHead = 0;
+                    fTail = 0;
+                }
+
+                fSizeUntilCut = fInternalBuffer.Length - fHead;
+                return size;
+            }
+        }
+
         /// <summary>
         /// Peeks a byte with a relative index to the fHead
         /// Note: should be used for special cases only, as it is rather slow
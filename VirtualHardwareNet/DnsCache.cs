@@ -0,0 +1,241 @@
+﻿/*
+  DnsCache.cs - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+using System;
+using System.Collections.Generic;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace VirtualHardwareNet
+{
+    /// <summary>
+    /// IPv4 addresses of host names, shared by all sockets of an EthernetNet. A name is resolved
+    /// once per TTL, a failed lookup is remembered for the shorter negative TTL. The resolver of
+    /// .NET does not report the TTL of the DNS records, so both are fixed and configurable.
+    /// </summary>
+    public sealed class DnsCache
+    {
+        private const uint _constPositiveTtlMillis = 60000;
+        private const uint _constNegativeTtlMillis = 5000;
+        private const int _constMaxEntries = 256;
+
+        private sealed class Entry
+        {
+            public IPAddress[] Addresses;
+            // of a failed lookup, Addresses is null
+            public SocketException Error;
+            public int Expires;
+        }
+
+        private readonly object _lock = new object();
+        private readonly Dictionary<string, Entry> _entries = new Dictionary<string, Entry>(StringComparer.OrdinalIgnoreCase);
+        private uint _positiveTtl = _constPositiveTtlMillis;
+        private uint _negativeTtl = _constNegativeTtlMillis;
+        private long _hits;
+        private long _misses;
+
+        /// <summary>
+        /// Lookups answered from the cache.
+        /// </summary>
+        public long Hits
+        {
+            get { return Interlocked.Read(ref _hits); }
+        }
+
+        /// <summary>
+        /// Lookups which asked the resolver.
+        /// </summary>
+        public long Misses
+        {
+            get { return Interlocked.Read(ref _misses); }
+        }
+
+        /// <summary>
+        /// Set the time resolved and failed names are kept, 0 does not cache them. Clears the cache.
+        /// </summary>
+        public void SetTtl(uint positiveMillis, uint negativeMillis)
+        {
+            lock (_lock) {
+                _positiveTtl = Math.Min(positiveMillis, int.MaxValue);
+                _negativeTtl = Math.Min(negativeMillis, int.MaxValue);
+                _entries.Clear();
+            }
+        }
+
+        public void Clear()
+        {
+            lock (_lock) {
+                _entries.Clear();
+            }
+        }
+
+        /// <summary>
+        /// The IPv4 addresses of a host name or a dotted IP address, like Dns.GetHostAddresses.
+        /// </summary>
+        /// <exception cref="SocketException">the name is unknown or has no IPv4 address.</exception>
+        public IPAddress[] GetHostAddresses(string hostname)
+        {
+            IPAddress[] addresses;
+            SocketException error;
+            if (tryGetCached(hostname, out addresses, out error)) {
+                if (error != null) {
+                    throw error;
+                }
+                return addresses;
+            }
+
+            try {
+                addresses = store(hostname, Dns.GetHostAddresses(hostname));
+            } catch (SocketException e) {
+                store(hostname, e);
+                throw;
+            }
+            if (addresses.Length == 0) {
+                throw noAddress();
+            }
+            return addresses;
+        }
+
+        /// <summary>
+        /// As GetHostAddresses, completes at once from the cache or when the resolver answered.
+        /// </summary>
+        public Task<IPAddress[]> GetHostAddressesAsync(string hostname)
+        {
+            IPAddress[] addresses;
+            SocketException error;
+            if (tryGetCached(hostname, out addresses, out error)) {
+                var cached = new TaskCompletionSource<IPAddress[]>();
+                if (error != null) {
+                    cached.SetException(error);
+                } else {
+                    cached.SetResult(addresses);
+                }
+                return cached.Task;
+            }
+
+            return Dns.GetHostAddressesAsync(hostname).ContinueWith(lookup => {
+                if (lookup.IsFaulted) {
+                    var e = lookup.Exception.InnerException as SocketException;
+                    if (e != null) {
+                        store(hostname, e);
+                        throw e;
+                    }
+                    throw lookup.Exception.InnerException;
+                }
+                IPAddress[] resolved = store(hostname, lookup.Result);
+                if (resolved.Length == 0) {
+                    throw noAddress();
+                }
+                return resolved;
+            }, TaskContinuationOptions.ExecuteSynchronously);
+        }
+
+        private bool tryGetCached(string hostname, out IPAddress[] addresses, out SocketException error)
+        {
+            error = null;
+            IPAddress address;
+            if (IPAddress.TryParse(hostname, out address)) {
+                // nothing to resolve, not counted
+                addresses = new IPAddress[] { address };
+                return true;
+            }
+
+            lock (_lock) {
+                Entry entry;
+                if (_entries.TryGetValue(hostname, out entry)) {
+                    if (unchecked(Environment.TickCount - entry.Expires) < 0) {
+                        addresses = entry.Addresses;
+                        error = entry.Error;
+                        _hits++;
+                        return true;
+                    }
+                    _entries.Remove(hostname);
+                }
+                _misses++;
+            }
+            addresses = null;
+            return false;
+        }
+
+        // Keeps the IPv4 addresses of a lookup, a name without any is stored as failed
+        private IPAddress[] store(string hostname, IPAddress[] resolved)
+        {
+            var addresses = Array.FindAll(resolved, item => item.AddressFamily == AddressFamily.InterNetwork);
+            if (addresses.Length == 0) {
+                store(hostname, noAddress());
+            } else {
+                store(hostname, new Entry { Addresses = addresses }, _positiveTtl);
+            }
+            return addresses;
+        }
+
+        private void store(string hostname, SocketException error)
+        {
+            store(hostname, new Entry { Error = error }, _negativeTtl);
+        }
+
+        private void store(string hostname, Entry entry, uint ttl)
+        {
+            lock (_lock) {
+                if (ttl == 0) {
+                    return;
+                }
+                if (_entries.Count >= _constMaxEntries && !_entries.ContainsKey(hostname)) {
+                    removeExpired();
+                    if (_entries.Count >= _constMaxEntries) {
+                        _entries.Clear();
+                    }
+                }
+                entry.Expires = unchecked(Environment.TickCount + (int)ttl);
+                _entries[hostname] = entry;
+            }
+        }
+
+        // The lock must be held
+        private void removeExpired()
+        {
+            var expired = new List<string>();
+            foreach (var pair in _entries) {
+                if (unchecked(Environment.TickCount - pair.Value.Expires) >= 0) {
+                    expired.Add(pair.Key);
+                }
+            }
+            foreach (var hostname in expired) {
+                _entries.Remove(hostname);
+            }
+        }
+
+        private static SocketException noAddress()
+        {
+            // WSANO_DATA, the name is valid but has no IPv4 address
+            return new SocketException((int)SocketError.NoData);
+        }
+    }
+}
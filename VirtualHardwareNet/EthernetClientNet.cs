@@ -27,7 +27,6 @@
 */
 
 using System;
-using System.Collections;
 using System.Collections.Generic;
 using System.IO;
 using System.Linq;
@@ -39,34 +38,40 @@ using System.Threading.Tasks;
 
 namespace VirtualHardwareNet
 {
-    public class EthernetClientNet : IDisposable
+    public class EthernetClientNet : IDisposable, IEthernetReactorSocket
     {
         private const int _constBufferSize = 1024;
         private TcpClient _client;
-//        private Thread _clientThread;
-        private ByteQueue _receiveQueue = new ByteQueue();
-        private ByteQueue _sendQueue = new ByteQueue();
-        private readonly ManualResetEvent _mreHandleClient = new ManualResetEvent(false);
+        private Socket _socket;
+        private readonly EthernetReactor _reactor;
+        private readonly DnsCache _dnsCache;
+        // the reactor receives and sends in place of these queues
+        private SpscByteQueue _receiveQueue = new SpscByteQueue(_constBufferSize);
+        private SpscByteQueue _sendQueue = new SpscByteQueue(_constBufferSize);
+        // 1 if the reactor stopped receiving because the receive queue is full
+        private int _receiveStalled;
 
-        private volatile bool _treadActive;
         private volatile bool _socketConnected = false;
 
+        // asynchronous connect in progress, guarded by _connectLock
+        private readonly object _connectLock = new object();
+        private TcpClient _pendingClient;
+        private int _connectStarted;
+        private uint _connectTimeout;
+        private volatile bool _connectPending = false;
+
         public string ErrorMessage { get; private set; }
         public string SocketErrorCode { get; private set; }
         public int ErrorCode { get; private set; }
 
-        private volatile bool _allocated;
-        public bool Allocated
-        {
-            get { return _allocated; }
-            set { _allocated = value; }
-        }
-
         /// <summary>
         /// EthernetClient constructor.
         /// </summary>
-        public EthernetClientNet()
+        /// <param name="reactor">serving the socket of this client.</param>
+        public EthernetClientNet(EthernetReactor reactor, DnsCache dnsCache)
         {
+            _reactor = reactor;
+            _dnsCache = dnsCache;
         }
 
         /// <summary>
@@ -77,10 +82,35 @@ namespace VirtualHardwareNet
         /// <returns>1 if SUCCESS or 0 if FAILURE</returns>
         public int connect(string hostname, ushort port)
         {
-            TcpClient client;
+            return connect(hostname, port, 0);
+        }
+
+        /// <summary>
+        /// Initiate a connection with host:port, give up after a timeout.
+        /// </summary>
+        /// <param name="host">name to resolve or a stringified dotted IP address.</param>
+        /// <param name="port">to connect to.</param>
+        /// <param name="timeoutMillis">for connecting after the name is resolved, 0 for the timeout of the system.</param>
+        /// <returns>1 if SUCCESS or 0 if FAILURE</returns>
+        public int connect(string hostname, ushort port, uint timeoutMillis)
+        {
+            TcpClient client = null;
             try {
-                client = new TcpClient(hostname, port);
+                IPAddress[] addresses = _dnsCache.GetHostAddresses(hostname);
+                client = new TcpClient();
+                if (timeoutMillis == 0) {
+                    client.Connect(addresses, port);
+                } else {
+                    IAsyncResult result = client.BeginConnect(addresses, port, null, null);
+                    if (!result.AsyncWaitHandle.WaitOne((int)Math.Min(timeoutMillis, int.MaxValue))) {
+                        throw new SocketException((int)SocketError.TimedOut);
+                    }
+                    client.EndConnect(result);
+                }
             } catch (Exception e) {
+                if (client != null) {
+                    client.Close();
+                }
                 setExceptionMessage(e);
                 return 0;
             }
@@ -88,6 +118,96 @@ namespace VirtualHardwareNet
             return 1;
         }
 
+        /// <summary>
+        /// Start a connection with host:port and return at once, status() is SYNSENT
+        /// until the connection is established, failed or timed out.
+        /// </summary>
+        /// <param name="host">name to resolve or a stringified dotted IP address.</param>
+        /// <param name="port">to connect to.</param>
+        /// <param name="timeoutMillis">for resolving and connecting, 0 for the timeout of the system.</param>
+        /// <returns>1, a failure is reported by status() and the error properties</returns>
+        public int connectAsync(string hostname, ushort port, uint timeoutMillis)
+        {
+            close();
+
+            var client = new TcpClient();
+            lock (_connectLock) {
+                _pendingClient = client;
+                _connectStarted = Environment.TickCount;
+                _connectTimeout = timeoutMillis;
+                _connectPending = true;
+            }
+            _dnsCache.GetHostAddressesAsync(hostname).ContinueWith(lookup => {
+                if (lookup.IsFaulted) {
+                    connectFinished(client, lookup.Exception.InnerException);
+                    return;
+                }
+                try {
+                    client.BeginConnect(lookup.Result, port, connectCompleted, client);
+                } catch (Exception e) {
+                    connectFinished(client, e);
+                }
+            });
+            return 1;
+        }
+
+        private void connectCompleted(IAsyncResult result)
+        {
+            var client = (TcpClient)result.AsyncState;
+            Exception error = null;
+            try {
+                client.EndConnect(result);
+            } catch (Exception e) {
+                error = e;
+            }
+            connectFinished(client, error);
+        }
+
+        private void connectFinished(TcpClient client, Exception error)
+        {
+            lock (_connectLock) {
+                if (_pendingClient != client) {
+                    // timed out or closed meanwhile
+                    client.Close();
+                    return;
+                }
+                _pendingClient = null;
+                if (error != null) {
+                    setExceptionMessage(error);
+                    client.Close();
+                } else {
+                    attach(client);
+                }
+                _connectPending = false;
+            }
+        }
+
+        /// <summary>
+        /// Whether an asynchronous connect is still in progress, fails it when timed out.
+        /// </summary>
+        private bool connectPending()
+        {
+            if (!_connectPending) {
+                return false;
+            }
+
+            TcpClient client;
+            lock (_connectLock) {
+                if (!_connectPending) {
+                    return false;
+                }
+                if (_connectTimeout == 0 || (uint)unchecked(Environment.TickCount - _connectStarted) < _connectTimeout) {
+                    return true;
+                }
+                client = _pendingClient;
+                _pendingClient = null;
+                _connectPending = false;
+                setExceptionMessage(new SocketException((int)SocketError.TimedOut));
+            }
+            client.Close();
+            return false;
+        }
+
         public void connect(TcpClient client)
         {
             if (client == null) {
@@ -95,17 +215,18 @@ namespace VirtualHardwareNet
             }
 
             close();
+            attach(client);
+        }
 
+        private void attach(TcpClient client)
+        {
             _client = client;
             _client.NoDelay = true;
-            _treadActive = true;
+            _socket = _client.Client;
+            _socket.Blocking = false;
 
-            // Keep this client socket allocated (after close() of any old socket connection).
-            Allocated = true;
-
-            var clientThread = new Thread(new ParameterizedThreadStart(handleClient));
-            clientThread.Start(_client);
             _socketConnected = true;
+            _reactor.Register(this);
 
             Thread.Yield();
         }
@@ -123,84 +244,82 @@ namespace VirtualHardwareNet
             }
         }
 
-        private void handleClient(object obj)
+        Socket IEthernetReactorSocket.Socket
         {
-            NetworkStream clientStream = null;
-            try {
-                var client = obj as TcpClient;
-                clientStream = client.GetStream();
-                byte[] buffer = new byte[_constBufferSize];
-                int count;
-                while (_treadActive) {
-                    _socketConnected = isSocketConnected(client);
-
-                    if (clientStream.DataAvailable) {
-                        int length = buffer.Length - _receiveQueue.Length;
-                        count = clientStream.Read(buffer, 0, length);
-                        if (count > 0) {
-                            _receiveQueue.Enqueue(buffer, 0, count);
-                        }
-                    }
+            get { return _socket; }
+        }
 
-                    count = _sendQueue.Length;
-                    if (count > 0) {
-                        if (count > buffer.Length) {
-                            count = buffer.Length;
-                        }
-                        _sendQueue.Dequeue(buffer, 0, count);
-                        clientStream.Write(buffer, 0, count);
-                    }
-                    // prevent high CPU usage
-                    Thread.Sleep(10);
+        bool IEthernetReactorSocket.WantsRead
+        {
+            get {
+                if (!_socketConnected) {
+                    return false;
                 }
-            } catch (Exception e) {
-                setExceptionMessage(e);
-            } finally {
-                _socketConnected = false;
-
-                // One have to close the stream before closing the connection
-                // see: https://stackoverflow.com/questions/425235/how-to-properly-and-completely-close-reset-a-tcpclient-connection
-                if (clientStream != null) {
-                    try {
-                        clientStream.Close();
-                    } catch (Exception e) {
-                        setExceptionMessage(e);
-                    }
+                if (_receiveQueue.Free > 0) {
+                    return true;
                 }
-                _mreHandleClient.Set();
+
+                // same handshake as the reactor wake, announce the stall before checking a last time
+                Interlocked.Exchange(ref _receiveStalled, 1);
+                return _receiveQueue.Free > 0;
             }
         }
 
-        private bool isSocketConnected(TcpClient client)
+        bool IEthernetReactorSocket.WantsWrite
         {
-            if (client == null || !client.Connected) {
-                return false;
+            get { return _socketConnected && _sendQueue.Length > 0; }
+        }
+
+        void IEthernetReactorSocket.OnReadable()
+        {
+            var segment = _receiveQueue.GetWriteSegment();
+            if (segment.Count == 0) {
+                return;
             }
 
-            Socket socket = client.Client;
-            if (socket == null || !socket.Connected) {
-                return false;
+            SocketError error;
+            int count = _socket.Receive(segment.Array, segment.Offset, segment.Count, SocketFlags.None, out error);
+            if (error == SocketError.WouldBlock) {
+                return;
             }
+            if (error != SocketError.Success) {
+                setExceptionMessage(new SocketException((int)error));
+                _socketConnected = false;
+                return;
+            }
+            if (count == 0) {
+                // connection closed by the remote host
+                _socketConnected = false;
+                return;
+            }
+            _receiveQueue.CommitWrite(count);
+        }
 
-            // see:
-            // https://stackoverflow.com/questions/6993295/how-to-determine-if-the-tcp-is-connected-or-not
-            // https://social.msdn.microsoft.com/Forums/en-US/c857cad5-2eb6-4b6c-b0b5-7f4ce320c5cd/c-how-to-determine-if-a-tcpclient-has-been-disconnected?forum=netfxnetcom
-            bool socketClosed = false;
+        void IEthernetReactorSocket.OnWritable()
+        {
+            var segment = _sendQueue.GetReadSegment();
+            if (segment.Count == 0) {
+                return;
+            }
 
-            //if (socket.Poll(01, SelectMode.SelectWrite)
-            //    && socket.Poll(01, SelectMode.SelectRead)
-            //    && !socket.Poll(01, SelectMode.SelectError))
+            SocketError error;
+            int count = _socket.Send(segment.Array, segment.Offset, segment.Count, SocketFlags.None, out error);
+            if (error == SocketError.WouldBlock) {
+                return;
+            }
+            if (error != SocketError.Success) {
+                setExceptionMessage(new SocketException((int)error));
+                _socketConnected = false;
+                return;
+            }
+            _sendQueue.CommitRead(count);
+        }
 
-            if (socket.Poll(0, SelectMode.SelectRead)) {
-                byte[] buff = new byte[1];
-                try {
-                    socketClosed = (socket.Receive(buff, SocketFlags.Peek) == 0);
-                } catch (SocketException e) {
-                    var error = e.SocketErrorCode;
-                    socketClosed = true;
-                }
+        private void resumeReceive()
+        {
+            if (Interlocked.Exchange(ref _receiveStalled, 0) == 1) {
+                _reactor.Wake();
             }
-            return !socketClosed;
         }
 
         public ushort remotePort()
@@ -233,6 +352,20 @@ namespace VirtualHardwareNet
             return endPoint.Address.ToString();
         }
 
+        public uint remoteIp()
+        {
+            if (_client == null) {
+                return 0;
+            }
+
+            var endPoint = _client.Client.RemoteEndPoint as IPEndPoint;
+            if (endPoint == null || endPoint.AddressFamily != AddressFamily.InterNetwork) {
+                return 0;
+            }
+
+            return BitConverter.ToUInt32(endPoint.Address.GetAddressBytes(), 0);
+        }
+
         /// <summary>
         /// Write a byte.
         /// </summary>
@@ -255,11 +388,8 @@ namespace VirtualHardwareNet
                 return 0;
             }
 
-            int length = _constBufferSize - _sendQueue.Length;
-            if (size > length) {
-                size = (uint)length;
-            }
-            _sendQueue.Enqueue(buf, 0, (int)size);
+            size = (uint)_sendQueue.Enqueue(buf, 0, (int)size);
+            _reactor.Wake();
 
             Thread.Yield();
 
@@ -302,6 +432,7 @@ namespace VirtualHardwareNet
                 if (_receiveQueue.Dequeue(buffer, 0, 1) == 1) {
                     result = buffer[0];
                 }
+                resumeReceive();
             }
 
             return result;
@@ -322,6 +453,28 @@ namespace VirtualHardwareNet
             length = bytes > length ? length : (int)bytes;
             if (length > 0) {
                 result = _receiveQueue.Dequeue(buf, 0, length);
+                resumeReceive();
+            }
+
+            return result;
+        }
+
+        /// <summary>
+        /// Read a number of bytes directly into caller memory.
+        /// </summary>
+        /// <param name="buf">Pointer to the memory to write to.</param>
+        /// <param name="bytes">number of bytes to read.</param>
+        /// <returns>-1 if no data or number of read bytes.</returns>
+        public unsafe int read(byte* buf, uint bytes)
+        {
+            Thread.Yield();
+
+            int result = -1;
+            int length = _receiveQueue.Length;
+            length = bytes > length ? length : (int)bytes;
+            if (length > 0) {
+                result = _receiveQueue.Dequeue(buf, length);
+                resumeReceive();
             }
 
             return result;
@@ -390,6 +543,10 @@ namespace VirtualHardwareNet
             #define ETHERNETCLIENT_W5100_LAST_ACK 0x1D
             */
 
+            if (connectPending()) {
+                return 0x15;    // ETHERNETCLIENT_W5100_SYNSENT
+            }
+
             if (_client == null) {
                 return 0x00;    // ETHERNETCLIENT_W5100_CLOSED
             }
@@ -409,6 +566,9 @@ namespace VirtualHardwareNet
         /// <returns>1 if the client is connected, 0 if not.</returns>
         public byte connected()
         {
+            if (connectPending()) {
+                return 0;
+            }
             return (byte)(_receiveQueue.Length > 0 || _socketConnected ? 1 :0);
 
             //if (_receiveQueue.Length > 0)
@@ -450,18 +610,33 @@ namespace VirtualHardwareNet
         /// </summary>
         public void close()
         {
+            TcpClient pendingClient = null;
+            lock (_connectLock) {
+                if (_connectPending) {
+                    pendingClient = _pendingClient;
+                    _pendingClient = null;
+                    _connectPending = false;
+                }
+            }
+            if (pendingClient != null) {
+                // the completion callback finds the connect abandoned
+                pendingClient.Close();
+            }
+
             if (_client != null) {
-                // signal and wait for thread handleClient() has finished
-                _treadActive = false;
-                _mreHandleClient.WaitOne();
+                // wait until the reactor no longer uses the socket
+                _reactor.Unregister(this);
+                _socketConnected = false;
 
+                // a lingering close needs a blocking socket
+                _socket.Blocking = true;
                 _client.Close();
                 _client = null;
+                _socket = null;
 
                 _sendQueue.Clear();
                 _receiveQueue.Clear();
             }
-            Allocated = false;
         }
 
         /// <summary>
@@ -38,18 +38,29 @@ namespace VirtualHardwareNet
 {
     public class EthernetNet
     {
+        // default socket limits, see init()
         public static readonly int MAX_UDP_CLIENTS = 8;
         public static readonly int MAX_CLIENTS = 8;
         public static readonly int MAX_SERVERS = 2;
+        private const int _constMaxSockets = 4096;
 
         public string ErrorMessage { get; private set; }
         public string SocketErrorCode { get; private set; }
         public int ErrorCode { get; private set; }
 
-        private EthernetUdpNet[] _udpClients = new EthernetUdpNet[MAX_UDP_CLIENTS];
-        private EthernetClientNet[] _clients = new EthernetClientNet[MAX_CLIENTS];
-        private EthernetServerNet[] _servers = new EthernetServerNet[MAX_SERVERS];
+        private SocketTable<EthernetUdpNet> _udpClients = new SocketTable<EthernetUdpNet>(MAX_UDP_CLIENTS);
+        private SocketTable<EthernetClientNet> _clients = new SocketTable<EthernetClientNet>(MAX_CLIENTS);
+        private SocketTable<EthernetServerNet> _servers = new SocketTable<EthernetServerNet>(MAX_SERVERS);
+        // one thread serves all sockets above
+        private readonly EthernetReactor _reactor = new EthernetReactor();
+        // host names resolved for all client and UDP sockets
+        private readonly DnsCache _dnsCache = new DnsCache();
         private IPAddress _localIpAddress;
+        // of clientConnect(), 0 for the timeout of the system
+        private uint _connectionTimeout = 0;
+        private bool _asyncConnect = false;
+        // of serverBegin(), 0 for the maximum of the system
+        private int _listenBacklog = 0;
         IPAddress _subnetMask;
         IPAddress _gatewayIpAddress;
         IPAddress _dnsIpAddress;
@@ -59,6 +70,11 @@ namespace VirtualHardwareNet
             GetIpV4Configuration(out _localIpAddress, out _subnetMask, out _gatewayIpAddress, out _dnsIpAddress);
         }
 
+        internal EthernetReactor Reactor
+        {
+            get { return _reactor; }
+        }
+
         public uint localIpAddress()
         {
             return BitConverter.ToUInt32(_localIpAddress.GetAddressBytes(), 0);
@@ -69,6 +85,30 @@ namespace VirtualHardwareNet
             return BitConverter.ToUInt32(_dnsIpAddress.GetAddressBytes(), 0);
         }
 
+        /// <summary>
+        /// Host name lookups of clientConnect() and udpBeginPacket() answered from the cache.
+        /// </summary>
+        public long dnsCacheHits()
+        {
+            return _dnsCache.Hits;
+        }
+
+        /// <summary>
+        /// Host name lookups of clientConnect() and udpBeginPacket() which asked the resolver.
+        /// </summary>
+        public long dnsCacheMisses()
+        {
+            return _dnsCache.Misses;
+        }
+
+        /// <summary>
+        /// Set the time resolved and unknown host names are cached, 0 does not cache them.
+        /// </summary>
+        public void dnsSetCacheTtl(uint positiveMillis, uint negativeMillis)
+        {
+            _dnsCache.SetTtl(positiveMillis, negativeMillis);
+        }
+
         public uint gatewayAddress()
         {
             return BitConverter.ToUInt32(_gatewayIpAddress.GetAddressBytes(), 0);
@@ -147,41 +187,61 @@ namespace VirtualHardwareNet
             return false;
         }
 
-        public EthernetUdpNet NewUdpClient(ref int socketNumber)
+        /// <summary>
+        /// Set the number of sockets of each kind, only while no socket is in use.
+        /// </summary>
+        /// <param name="maxClients">number of TCP client sockets, including accepted ones.</param>
+        /// <param name="maxServers">number of TCP server sockets.</param>
+        /// <param name="maxUdpClients">number of UDP sockets.</param>
+        /// <returns>1 if SUCCESS or 0 if FAILURE</returns>
+        public int init(int maxClients, int maxServers, int maxUdpClients)
         {
-            lock (_udpClients) {
-                for (int i = 0; i < _udpClients.Length; i++) {
-                    if (_udpClients[i] == null || !_udpClients[i].Allocated) {
-                        if (_udpClients[i] == null) {
-                            _udpClients[i] = new EthernetUdpNet();
-                        }
+            if (maxClients <= 0 || maxClients > _constMaxSockets
+                || maxServers <= 0 || maxServers > _constMaxSockets
+                || maxUdpClients <= 0 || maxUdpClients > _constMaxSockets) {
+                return 0;
+            }
 
-                        _udpClients[i].Allocated = true;
-                        socketNumber = i;
-                        return _udpClients[i];
+            lock (_clients) {
+                lock (_servers) {
+                    lock (_udpClients) {
+                        if (_clients.Count > 0 || _servers.Count > 0 || _udpClients.Count > 0) {
+                            return 0;
+                        }
+                        _clients.Resize(maxClients);
+                        _servers.Resize(maxServers);
+                        _udpClients.Resize(maxUdpClients);
                     }
                 }
             }
-
-            socketNumber = -1;
-            return null;
+            return 1;
         }
 
-        private bool _disposeUdpClient(int socketNumber)
+        public EthernetUdpNet NewUdpClient(ref int socketNumber)
         {
             lock (_udpClients) {
-                if (_udpClients[socketNumber] != null) {
-                    _udpClients[socketNumber] = null;
-                    return true;
+                socketNumber = _udpClients.Allocate();
+                if (socketNumber == -1) {
+                    return null;
                 }
+                if (_udpClients[socketNumber] == null) {
+                    _udpClients[socketNumber] = new EthernetUdpNet(_reactor, _dnsCache);
+                }
+                return _udpClients[socketNumber];
+            }
+        }
+
+        private void releaseUdpClient(int socketNumber)
+        {
+            lock (_udpClients) {
+                _udpClients.Release(socketNumber);
             }
-            return false;
         }
 
         private bool tryGetUdpClient(int socketNumber, out EthernetUdpNet updClient)
         {
             updClient = null;
-            if (socketNumber < 0 || socketNumber >= MAX_UDP_CLIENTS) {
+            if (!_udpClients.IsValid(socketNumber)) {
                 return false;
             }
 
@@ -196,27 +256,28 @@ namespace VirtualHardwareNet
         public EthernetClientNet NewClient(ref int socketNumber)
         {
             lock (_clients) {
-                for (int i = 0; i < _clients.Length; i++) {
-                    if (_clients[i] == null || !_clients[i].Allocated) {
-                        if (_clients[i] == null) {
-                            _clients[i] = new EthernetClientNet();
-                        }
-
-                        _clients[i].Allocated = true;
-                        socketNumber = i;
-                        return _clients[i];
-                    }
+                socketNumber = _clients.Allocate();
+                if (socketNumber == -1) {
+                    return null;
                 }
+                if (_clients[socketNumber] == null) {
+                    _clients[socketNumber] = new EthernetClientNet(_reactor, _dnsCache);
+                }
+                return _clients[socketNumber];
             }
+        }
 
-            socketNumber = -1;
-            return null;
+        private void releaseClient(int socketNumber)
+        {
+            lock (_clients) {
+                _clients.Release(socketNumber);
+            }
         }
 
         private bool tryGetClient(int socketNumber, out EthernetClientNet client)
         {
             client = null;
-            if (socketNumber < 0 || socketNumber >= MAX_CLIENTS) {
+            if (!_clients.IsValid(socketNumber)) {
                 return false;
             }
 
@@ -230,21 +291,27 @@ namespace VirtualHardwareNet
 
         private EthernetServerNet newServer(ref int socketNumber)
         {
-            for (int i = 0; i < _servers.Length; i++) {
-                if (_servers[i] == null) {
-                    _servers[i] = new EthernetServerNet(this);
-                    socketNumber = i;
-                    return _servers[i];
+            lock (_servers) {
+                socketNumber = _servers.Allocate();
+                if (socketNumber == -1) {
+                    return null;
                 }
+                _servers[socketNumber] = new EthernetServerNet(this);
+                return _servers[socketNumber];
+            }
+        }
+
+        private void releaseServer(int socketNumber)
+        {
+            lock (_servers) {
+                _servers.Release(socketNumber);
             }
-            socketNumber = -1;
-            return null;
         }
 
         private bool tryGetServer(int socketNumber, out EthernetServerNet server)
         {
             server = null;
-            if (socketNumber < 0 || socketNumber >= MAX_CLIENTS) {
+            if (!_servers.IsValid(socketNumber)) {
                 return false;
             }
 
@@ -302,7 +369,14 @@ namespace VirtualHardwareNet
         {
             EthernetClientNet client = NewClient(ref socketNumber);
             if (client != null) {
-                return client.connect(hostname, port);
+                int result = _asyncConnect
+                    ? client.connectAsync(hostname, port, _connectionTimeout)
+                    : client.connect(hostname, port, _connectionTimeout);
+                if (result != 1) {
+                    // the error stays readable through clientErrorMessage(socketNumber)
+                    releaseClient(socketNumber);
+                }
+                return result;
             }
 
             // all TcpClient sockets used
@@ -310,6 +384,24 @@ namespace VirtualHardwareNet
             return -1;
         }
 
+        /// <summary>
+        /// Limit the time of resolving and connecting in clientConnect(), like setConnectionTimeout() of the W5100.
+        /// </summary>
+        /// <param name="milliseconds">0 for the timeout of the system.</param>
+        public void clientSetConnectionTimeout(uint milliseconds)
+        {
+            _connectionTimeout = milliseconds;
+        }
+
+        /// <summary>
+        /// Let clientConnect() return at once, clientStatus() is SYNSENT while connecting
+        /// and clientConnected() true when established.
+        /// </summary>
+        public void clientSetAsyncConnect(bool enabled)
+        {
+            _asyncConnect = enabled;
+        }
+
         public int clientAvailable(int socketNumber)
         {
             EthernetClientNet client;
@@ -353,6 +445,7 @@ namespace VirtualHardwareNet
             EthernetClientNet client;
             if (tryGetClient(socketNumber, out client)) {
                 client.stop();
+                releaseClient(socketNumber);
             }
         }
 
@@ -371,6 +464,7 @@ namespace VirtualHardwareNet
             EthernetClientNet client;
             if (tryGetClient(socketNumber, out client)) {
                 client.close();
+                releaseClient(socketNumber);
             }
         }
 
@@ -394,6 +488,16 @@ namespace VirtualHardwareNet
             return -1;
         }
 
+        public unsafe int clientRead(int socketNumber, byte* buf, uint bytes)
+        {
+            EthernetClientNet client;
+            if (tryGetClient(socketNumber, out client)) {
+                return client.read(buf, bytes);
+            }
+
+            return -1;
+        }
+
         public string clientRemoteIpAddress(int socketNumber)
         {
             EthernetClientNet client;
@@ -404,6 +508,16 @@ namespace VirtualHardwareNet
             return null;
         }
 
+        public uint clientRemoteIp(int socketNumber)
+        {
+            EthernetClientNet client;
+            if (tryGetClient(socketNumber, out client)) {
+                return client.remoteIp();
+            }
+
+            return 0;
+        }
+
         public ushort clientRemotePort(int socketNumber)
         {
             EthernetClientNet client;
@@ -448,7 +562,12 @@ namespace VirtualHardwareNet
         {
             EthernetServerNet server = newServer(ref socketNumber);
             if (server != null) {
-                return server.begin(ipAddress, port);
+                int result = server.begin(ipAddress, port, _listenBacklog);
+                if (result != 1) {
+                    // the error stays readable through serverErrorMessage(socketNumber)
+                    releaseServer(socketNumber);
+                }
+                return result;
             }
 
             // all TcpClient sockets used
@@ -456,6 +575,36 @@ namespace VirtualHardwareNet
             return -1;
         }
 
+        /// <summary>
+        /// Set the number of connections the system queues for a server until the reactor
+        /// accepts them, used by the following serverBegin() calls.
+        /// </summary>
+        /// <param name="backlog">0 for the maximum of the system.</param>
+        public void serverSetBacklog(int backlog)
+        {
+            _listenBacklog = backlog > 0 ? backlog : 0;
+        }
+
+        public long serverAcceptedClients(int socketNumber)
+        {
+            EthernetServerNet server;
+            if (tryGetServer(socketNumber, out server)) {
+                return server.AcceptedClients;
+            }
+
+            return 0;
+        }
+
+        public long serverRejectedClients(int socketNumber)
+        {
+            EthernetServerNet server;
+            if (tryGetServer(socketNumber, out server)) {
+                return server.RejectedClients;
+            }
+
+            return 0;
+        }
+
         public int serverAccept(int socketNumber)
         {
             EthernetServerNet server;
@@ -485,7 +634,11 @@ namespace VirtualHardwareNet
             EthernetUdpNet client;
             client = NewUdpClient(ref socketNumber);
             if (client != null) {
-                return client.begin(port);
+                int result = client.begin(port);
+                if (result != 1) {
+                    releaseUdpClient(socketNumber);
+                }
+                return result;
             }
 
             // all UdpClient sockets used
@@ -498,7 +651,11 @@ namespace VirtualHardwareNet
             EthernetUdpNet client = NewUdpClient(ref socketNumber);
             if (client != null) {
                 IPAddress multicastAddress = new IPAddress(ipAddress);
-                return client.beginMulticast(multicastAddress, port);
+                int result = client.beginMulticast(multicastAddress, port);
+                if (result != 1) {
+                    releaseUdpClient(socketNumber);
+                }
+                return result;
             }
 
             // all UdpClient sockets used
@@ -506,6 +663,15 @@ namespace VirtualHardwareNet
             return -1;
         }
 
+        public uint udpSetTxBufferSize(int socketNumber, uint size)
+        {
+            EthernetUdpNet client;
+            if (tryGetUdpClient(socketNumber, out client)) {
+                return client.setTxBufferSize(size);
+            }
+            return 0;
+        }
+
         public int udpBeginPacket(int socketNumber, string ipStr, ushort port)
         {
             EthernetUdpNet client;
@@ -524,6 +690,44 @@ namespace VirtualHardwareNet
             return -1;
         }
 
+        /// <summary>
+        /// Initiate a packet for native code, which writes it in place.
+        /// </summary>
+        /// <param name="data">the datagram buffer, valid until udpEndPacket or udpSetTxBufferSize.</param>
+        /// <param name="capacity">size of the datagram buffer.</param>
+        public int udpBeginPacket(int socketNumber, string ipStr, ushort port, out IntPtr data, out int capacity)
+        {
+            data = IntPtr.Zero;
+            capacity = 0;
+
+            EthernetUdpNet client;
+            if (tryGetUdpClient(socketNumber, out client)) {
+                return client.beginPacket(ipStr, port, out data, out capacity);
+            }
+            return 0;
+        }
+
+        /// <summary>
+        /// Send a packet written in place by native code.
+        /// </summary>
+        /// <param name="length">number of bytes written to the datagram buffer.</param>
+        public int udpEndPacket(int socketNumber, int length)
+        {
+            EthernetUdpNet client;
+            if (tryGetUdpClient(socketNumber, out client)) {
+                return client.endPacket(length);
+            }
+            return -1;
+        }
+
+        public void udpSetBatchMode(int socketNumber, bool enabled)
+        {
+            EthernetUdpNet client;
+            if (tryGetUdpClient(socketNumber, out client)) {
+                client.setBatchMode(enabled);
+            }
+        }
+
         public int udpParsePacket(int socketNumber, out uint remoteIpAddress, out ushort remotePort)
         {
             remoteIpAddress = 0;
@@ -536,6 +740,32 @@ namespace VirtualHardwareNet
             return -1;
         }
 
+        /// <summary>
+        /// Start processing the next received packet, for native code reading it in place.
+        /// </summary>
+        /// <param name="data">the payload, valid until the next udpParsePacket or udpClose.</param>
+        public int udpParsePacket(int socketNumber, out uint remoteIpAddress, out ushort remotePort, out IntPtr data)
+        {
+            remoteIpAddress = 0;
+            remotePort = 0;
+            data = IntPtr.Zero;
+
+            EthernetUdpNet client;
+            if (tryGetUdpClient(socketNumber, out client)) {
+                return client.parsePacket(out remoteIpAddress, out remotePort, out data);
+            }
+            return -1;
+        }
+
+        public long udpDroppedPackets(int socketNumber)
+        {
+            EthernetUdpNet client;
+            if (tryGetUdpClient(socketNumber, out client)) {
+                return client.DroppedPackets;
+            }
+            return 0;
+        }
+
         public uint udpWrite(int socketNumber, byte[] buf, uint size)
         {
             EthernetUdpNet client;
@@ -554,6 +784,15 @@ namespace VirtualHardwareNet
             return -1;
         }
 
+        public unsafe int udpRead(int socketNumber, byte* buf, uint bytes)
+        {
+            EthernetUdpNet client;
+            if (tryGetUdpClient(socketNumber, out client)) {
+                return client.read(buf, bytes);
+            }
+            return -1;
+        }
+
         public int udpPeek(int socketNumber)
         {
             EthernetUdpNet client;
@@ -568,7 +807,7 @@ namespace VirtualHardwareNet
             EthernetUdpNet client;
             if (tryGetUdpClient(socketNumber, out client)) {
                 client.close();
-                _disposeUdpClient(socketNumber);
+                releaseUdpClient(socketNumber);
             }
         }
         //----------------------
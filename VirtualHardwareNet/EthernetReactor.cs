@@ -0,0 +1,247 @@
+﻿/*
+  EthernetReactor.cs - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+using System;
+using System.Collections.Generic;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+
+namespace VirtualHardwareNet
+{
+    /// <summary>
+    /// A socket served by the EthernetReactor. All members are called on the reactor thread.
+    /// </summary>
+    internal interface IEthernetReactorSocket
+    {
+        Socket Socket { get; }
+
+        /// <summary>
+        /// True if the reactor should wait for incoming data or connections.
+        /// </summary>
+        bool WantsRead { get; }
+
+        /// <summary>
+        /// True if there is data to send.
+        /// </summary>
+        bool WantsWrite { get; }
+
+        void OnReadable();
+
+        void OnWritable();
+    }
+
+    /// <summary>
+    /// Serves all client, server and UDP sockets of an EthernetNet with a single thread
+    /// blocking in Socket.Select(). The sketch side wakes it through a loopback datagram.
+    /// </summary>
+    public sealed class EthernetReactor : IDisposable
+    {
+        // safety net only, the reactor is woken by Wake()
+        private const int _constSelectTimeout = 1000000;
+
+        private readonly object _lock = new object();
+        private readonly List<IEthernetReactorSocket> _sockets = new List<IEthernetReactorSocket>();
+        private bool _socketsChanged;
+        // counts the passes through the top of the loop, where the reactor holds no socket, guarded by _lock
+        private long _iteration;
+
+        private readonly Socket _wakeReceiver;
+        private readonly Socket _wakeSender;
+        private readonly byte[] _wakeBuffer = new byte[16];
+        // 1 while the reactor waits or is about to wait in Socket.Select()
+        private int _threadIdle;
+
+        private Thread _thread;
+        private volatile bool _threadActive;
+
+        public EthernetReactor()
+        {
+            _wakeReceiver = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+            _wakeReceiver.Bind(new IPEndPoint(IPAddress.Loopback, 0));
+            _wakeReceiver.Blocking = false;
+
+            _wakeSender = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+            _wakeSender.Connect(_wakeReceiver.LocalEndPoint);
+        }
+
+        /// <summary>
+        /// Add a socket, the reactor thread is started with the first one.
+        /// </summary>
+        internal void Register(IEthernetReactorSocket socket)
+        {
+            lock (_lock) {
+                _sockets.Add(socket);
+                _socketsChanged = true;
+
+                if (_thread == null) {
+                    _threadActive = true;
+                    _thread = new Thread(new ThreadStart(handleSockets));
+                    _thread.IsBackground = true;
+                    _thread.Start();
+                }
+            }
+            Wake();
+        }
+
+        /// <summary>
+        /// Remove a socket. When it returns the reactor no longer uses the socket
+        /// and the caller is free to close it.
+        /// </summary>
+        internal void Unregister(IEthernetReactorSocket socket)
+        {
+            long iteration;
+            lock (_lock) {
+                if (!_sockets.Remove(socket)) {
+                    return;
+                }
+                _socketsChanged = true;
+                iteration = _iteration;
+            }
+            Wake();
+
+            if (Thread.CurrentThread == _thread) {
+                return;
+            }
+
+            // the running iteration may still hold the socket, wait until the next one has started
+            lock (_lock) {
+                while (_iteration == iteration && _threadActive) {
+                    Monitor.Wait(_lock, 100);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Make the reactor re-evaluate WantsRead and WantsWrite of all sockets.
+        /// </summary>
+        internal void Wake()
+        {
+            // the reactor announces the wait before it evaluates the sockets,
+            // so only a waiting reactor needs the datagram
+            if (Interlocked.CompareExchange(ref _threadIdle, 0, 1) == 1) {
+                try {
+                    _wakeSender.Send(_wakeBuffer, 1, SocketFlags.None);
+                } catch (SocketException) {
+                    // receive buffer full, the reactor is woken anyway
+                }
+            }
+        }
+
+        private void handleSockets()
+        {
+            var sockets = new List<IEthernetReactorSocket>();
+            var handlers = new Dictionary<Socket, IEthernetReactorSocket>();
+            var readList = new List<Socket>();
+            var writeList = new List<Socket>();
+
+            while (_threadActive) {
+                Interlocked.Exchange(ref _threadIdle, 1);
+
+                lock (_lock) {
+                    if (_socketsChanged) {
+                        _socketsChanged = false;
+                        sockets.Clear();
+                        sockets.AddRange(_sockets);
+                        handlers.Clear();
+                        foreach (var socket in sockets) {
+                            handlers[socket.Socket] = socket;
+                        }
+                    }
+                    _iteration++;
+                    Monitor.PulseAll(_lock);
+                }
+
+                readList.Clear();
+                writeList.Clear();
+                readList.Add(_wakeReceiver);
+                foreach (var socket in sockets) {
+                    if (socket.WantsRead) {
+                        readList.Add(socket.Socket);
+                    }
+                    if (socket.WantsWrite) {
+                        writeList.Add(socket.Socket);
+                    }
+                }
+
+                try {
+                    Socket.Select(readList, writeList.Count > 0 ? writeList : null, null, _constSelectTimeout);
+                } catch (Exception) {
+                    // a socket was closed behind our back, rebuild the lists
+                    readList.Clear();
+                    writeList.Clear();
+                }
+                Interlocked.Exchange(ref _threadIdle, 0);
+
+                IEthernetReactorSocket handler;
+                foreach (var ready in readList) {
+                    if (ready == _wakeReceiver) {
+                        drainWakeReceiver();
+                    } else if (handlers.TryGetValue(ready, out handler)) {
+                        handler.OnReadable();
+                    }
+                }
+                foreach (var ready in writeList) {
+                    if (handlers.TryGetValue(ready, out handler)) {
+                        handler.OnWritable();
+                    }
+                }
+            }
+        }
+
+        private void drainWakeReceiver()
+        {
+            SocketError error;
+            while (_wakeReceiver.Available > 0) {
+                _wakeReceiver.Receive(_wakeBuffer, 0, _wakeBuffer.Length, SocketFlags.None, out error);
+                if (error != SocketError.Success) {
+                    return;
+                }
+            }
+        }
+
+        public void Dispose()
+        {
+            Thread thread;
+            lock (_lock) {
+                _threadActive = false;
+                thread = _thread;
+                Monitor.PulseAll(_lock);
+            }
+
+            if (thread != null) {
+                Interlocked.Exchange(ref _threadIdle, 1);
+                Wake();
+                thread.Join();
+            }
+
+            _wakeSender.Close();
+            _wakeReceiver.Close();
+        }
+    }
+}
@@ -27,6 +27,7 @@
 */
 
 using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Linq;
 using System.Net;
@@ -36,23 +37,51 @@ using System.Threading;
 
 namespace VirtualHardwareNet
 {
-    public class EthernetServerNet
+    public class EthernetServerNet : IEthernetReactorSocket
     {
         private TcpListener _tcpListener;
-        private Thread _listenThread;
-        private Queue<int> _newSocketNumbers = new Queue<int>();
+        // accepted by the reactor, not yet taken by the sketch
+        private readonly ConcurrentQueue<int> _newSocketNumbers = new ConcurrentQueue<int>();
         private EthernetNet _ethernet;
+        private long _acceptedClients;
+        private long _rejectedClients;
 
         public string ErrorMessage { get; private set; }
         public string SocketErrorCode { get; private set; }
         public int ErrorCode { get; private set; }
 
+        /// <summary>
+        /// Connections accepted and handed to a client socket.
+        /// </summary>
+        public long AcceptedClients
+        {
+            get { return Interlocked.Read(ref _acceptedClients); }
+        }
+
+        /// <summary>
+        /// Connections reset because all client sockets were in use.
+        /// </summary>
+        public long RejectedClients
+        {
+            get { return Interlocked.Read(ref _rejectedClients); }
+        }
+
         public EthernetServerNet(EthernetNet ethernet)
         {
             _ethernet = ethernet;
         }
 
         public int begin(string ipAddress, ushort port)
+        {
+            return begin(ipAddress, port, 0);
+        }
+
+        /// <summary>
+        /// Listen for connections.
+        /// </summary>
+        /// <param name="backlog">connections the system queues until they are accepted, 0 for its maximum.</param>
+        /// <returns>1 if SUCCESS or -1 if FAILURE</returns>
+        public int begin(string ipAddress, ushort port, int backlog)
         {
             IPAddress address;
             if (!IPAddress.TryParse(ipAddress, out address))
@@ -61,26 +90,25 @@ namespace VirtualHardwareNet
             try
             {
                 _tcpListener = new TcpListener(address, port);
+                _tcpListener.Start(backlog > 0 ? backlog : (int)SocketOptionName.MaxConnections);
+                _tcpListener.Server.Blocking = false;
             }
             catch (Exception e)
             {
                 setExceptionMessage(e);
                 return -1;
             }
-            _listenThread = new Thread(new ThreadStart(listenForClients));
-            _listenThread.Start();
+            _ethernet.Reactor.Register(this);
 
             return 1;
         }
 
         public int accept()
         {
-            lock (_newSocketNumbers)
-            {
-                if (_newSocketNumbers.Count > 0)
-                    return _newSocketNumbers.Dequeue();
+            int socketNumber;
+            if (_newSocketNumbers.TryDequeue(out socketNumber))
+                return socketNumber;
 
-            }
             return -1;
         }
 
@@ -134,46 +162,57 @@ namespace VirtualHardwareNet
             }
         }
 
-        private void listenForClients()
+        Socket IEthernetReactorSocket.Socket
         {
-            try
+            get { return _tcpListener.Server; }
+        }
+
+        bool IEthernetReactorSocket.WantsRead
+        {
+            get { return true; }
+        }
+
+        bool IEthernetReactorSocket.WantsWrite
+        {
+            get { return false; }
+        }
+
+        void IEthernetReactorSocket.OnReadable()
+        {
+            while (_tcpListener.Pending())
             {
-                _tcpListener.Start();
+                TcpClient tcpClient;
+                try
+                {
+                    tcpClient = _tcpListener.AcceptTcpClient();
+                }
+                catch (Exception e)
+                {
+                    setExceptionMessage(e);
+                    return;
+                }
 
-                while (true)
+                int socketNumber = -1;
+                EthernetClientNet ethernetClient = _ethernet.NewClient(ref socketNumber);
+                if (ethernetClient != null)
                 {
-                    TcpClient tcpClient = null;
-
-                    try
-                    {
-                        //blocks until a client has connected to the server
-                        tcpClient = _tcpListener.AcceptTcpClient();
-
-                        int socketNumber = -1;
-                        EthernetClientNet ethernetClient = _ethernet.NewClient(ref socketNumber);
-                        if (ethernetClient != null)
-                        {
-                            ethernetClient.connect(tcpClient);
-
-                            lock (_newSocketNumbers)
-                                _newSocketNumbers.Enqueue(socketNumber);
-                        }
-                        else
-                        {
-                            // all EternetClientNet sockets used, close new TCP client
-                            tcpClient.Close();
-                        }
-                    }
-                    catch
-                    {
-                        return;
-                    }
+                    ethernetClient.connect(tcpClient);
+                    _newSocketNumbers.Enqueue(socketNumber);
+                    Interlocked.Increment(ref _acceptedClients);
+                }
+                else
+                {
+                    // all EthernetClientNet sockets used, reset the connection like a refused one
+                    tcpClient.Client.LingerState = new LingerOption(true, 0);
+                    tcpClient.Close();
+                    Interlocked.Increment(ref _rejectedClients);
+                    setExceptionMessage(new SocketException((int)SocketError.TooManyOpenSockets));
                 }
             }
-            finally
-            {
-                // nothing to do for now
-            }
+        }
+
+        void IEthernetReactorSocket.OnWritable()
+        {
         }
     }
 }
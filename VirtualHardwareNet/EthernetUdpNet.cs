@@ -27,58 +27,112 @@
 */
 
 using System;
-using System.Collections;
 using System.Collections.Generic;
 using System.Linq;
 using System.Net;
 using System.Net.Sockets;
+using System.Runtime.InteropServices;
 using System.Text;
 using System.Threading;
 
 namespace VirtualHardwareNet
 {
-    public class EthernetUdpNet : IDisposable
+    public class EthernetUdpNet : IDisposable, IEthernetReactorSocket
     {
         // see:
         // https://stackoverflow.com/questions/19786668/c-sharp-udp-socket-client-and-server
 
-        private struct ReceiveResult {
-            public byte[] Buffer { get; }
-            public IPEndPoint RemoteEndPoint { get; }
-            public ReceiveResult(byte[] buffer, IPEndPoint remoteEndPoint)
-            {
-                Buffer = buffer;
-                RemoteEndPoint = remoteEndPoint;
-            }
-        }
-
         private UdpClient _client;
-        private Queue<ReceiveResult> _receivedPackets = new Queue<ReceiveResult>();
-        private ByteQueue _receiveQueue = new ByteQueue();
-        private ByteQueue _sendQueue = new ByteQueue();
+        // datagrams received by the reactor, bounded: a flood of broadcasts drops the newest ones
+        private const int _constRingPackets = 128;
+        private const int _constRingBytes = 2 * ushort.MaxValue;
+        private readonly UdpPacketRing _receivedPackets = new UdpPacketRing(_constRingPackets, _constRingBytes);
+        // reactor only, a datagram is received here and copied into the ring
+        private readonly byte[] _receiveBuffer = new byte[ushort.MaxValue];
+        private EndPoint _receiveEndPoint = new IPEndPoint(IPAddress.Any, 0);
+        // the packet of the last parsePacket, read in place from the ring
+        private IntPtr _packetData;
+        private int _packetLength;
+        private int _packetPosition;
+        // W5100 socket send buffer size, the limit for a datagram built with beginPacket/write/endPacket
+        private const int _constTxBufferSize = 2048;
+        private int _txBufferSize = _constTxBufferSize;
+        // the datagram between beginPacket and endPacket, pinned so native code appends to it in place
+        private byte[] _sendBuffer;
+        private GCHandle _sendHandle;
+        private int _sendLength;
         private IPEndPoint _packetEndpoint;
-
-        private readonly ManualResetEvent _mreHandleClient = new ManualResetEvent(false);
-        private volatile bool _treadActive;
+        // batch mode: endPacket queues the datagram, the reactor sends all queued ones per wakeup
+        private bool _batchMode;
+        private UdpPacketRing _sendPackets;
+        private byte[] _batchBuffer;
+        private IPEndPoint _batchEndpoint;
+        private readonly EthernetReactor _reactor;
+        private readonly DnsCache _dnsCache;
 
         private const int SIO_UDP_CONNRESET = -1744830452;
 
         public string ErrorMessage { get; private set; }
+        /// <summary>
+        /// Number of received datagrams dropped because the sketch did not parse them in time.
+        /// </summary>
+        public long DroppedPackets
+        {
+            get { return _receivedPackets.Dropped; }
+        }
+
         public string SocketErrorCode { get; private set; }
         public int ErrorCode { get; private set; }
 
-        private volatile bool _allocated;
-        public bool Allocated
+        /// <summary>
+        /// EthernetClient constructor.
+        /// </summary>
+        /// <param name="reactor">serving the socket of this client.</param>
+        public EthernetUdpNet(EthernetReactor reactor, DnsCache dnsCache)
+        {
+            _reactor = reactor;
+            _dnsCache = dnsCache;
+            allocateSendBuffer(_constTxBufferSize);
+        }
+
+        private void allocateSendBuffer(int size)
         {
-            get { return _allocated; }
-            set { _allocated = value; }
+            if (_sendHandle.IsAllocated) {
+                _sendHandle.Free();
+            }
+            _sendBuffer = new byte[size];
+            _sendHandle = GCHandle.Alloc(_sendBuffer, GCHandleType.Pinned);
+            _sendLength = 0;
         }
 
         /// <summary>
-        /// EthernetClient constructor.
+        /// Set the maximum size of a datagram, discards a packet not yet sent.
         /// </summary>
-        public EthernetUdpNet()
+        /// <param name="size">new size in bytes, at most 65507.</param>
+        /// <returns>0 if FAILURE or the new size.</returns>
+        public uint setTxBufferSize(uint size)
         {
+            if (size == 0 || size > 65507) {
+                return 0;
+            }
+
+            allocateSendBuffer((int)size);
+            _txBufferSize = (int)size;
+            return size;
+        }
+
+        /// <summary>
+        /// In batch mode endPacket only queues the datagram and the reactor thread sends the
+        /// queued datagrams together, for sketches sending many small packets per loop.
+        /// </summary>
+        /// <param name="enabled">true for batch mode.</param>
+        public void setBatchMode(bool enabled)
+        {
+            if (enabled && _sendPackets == null) {
+                _batchBuffer = new byte[ushort.MaxValue];
+                _sendPackets = new UdpPacketRing(_constRingPackets, _constRingBytes);
+            }
+            _batchMode = enabled;
         }
 
         public int begin(ushort port)
@@ -99,9 +153,8 @@ namespace VirtualHardwareNet
                 return 0;
             }
 
-            _treadActive = true;
-            var clientThread = new Thread(new ParameterizedThreadStart(handleClient));
-            clientThread.Start(_client);
+            _client.Client.Blocking = false;
+            _reactor.Register(this);
             return 1;
         }
 
@@ -124,26 +177,22 @@ namespace VirtualHardwareNet
                 return 0;
             }
 
-            _treadActive = true;
-            var clientThread = new Thread(new ParameterizedThreadStart(handleClient));
-            clientThread.Start(_client);
+            _client.Client.Blocking = false;
+            _reactor.Register(this);
             return 1;
         }
 
         private bool tryGetHostAddress(string hostname, out IPAddress ipAddress)
         {
-            IPAddress[] ipAaddresses = Dns.GetHostAddresses(hostname);
-
-            foreach (var item in ipAaddresses) {
-                // only use IP version 4 address
-                if (item.AddressFamily == AddressFamily.InterNetwork) {
-                    ipAddress = item;
-                    return true;
-                }
+            try {
+                // only IP version 4 addresses are cached
+                ipAddress = _dnsCache.GetHostAddresses(hostname)[0];
+                return true;
+            } catch (SocketException e) {
+                ErrorMessage = e.Message;
+                ipAddress = IPAddress.None;
+                return false;
             }
-
-            ipAddress = IPAddress.None;
-            return false;
         }
 
         /// <summary>
@@ -160,15 +209,67 @@ namespace VirtualHardwareNet
                     return 0;
                 }
             }
-            _packetEndpoint = new IPEndPoint(ipAddress, port);
+            if (_packetEndpoint == null || !_packetEndpoint.Address.Equals(ipAddress) || _packetEndpoint.Port != port) {
+                _packetEndpoint = new IPEndPoint(ipAddress, port);
+            }
+            _sendLength = 0;
             return 1;
         }
 
+        /// <summary>
+        /// Initiate a packet for native code, which writes it in place.
+        /// </summary>
+        /// <param name="data">the datagram buffer, valid until endPacket or setTxBufferSize.</param>
+        /// <param name="capacity">size of the datagram buffer.</param>
+        /// <returns>1 if SUCCESS or 0 if FAILURE</returns>
+        public int beginPacket(string hostname, ushort port, out IntPtr data, out int capacity)
+        {
+            data = _sendHandle.AddrOfPinnedObject();
+            capacity = _sendBuffer.Length;
+            return beginPacket(hostname, port);
+        }
+
+        /// <summary>
+        /// Send the packet, one syscall or queued for the reactor in batch mode.
+        /// </summary>
+        /// <returns>0 if FAILURE or the number of bytes sent.</returns>
         public int endPacket()
         {
-            byte[] buffer = new byte[_sendQueue.Length];
-            _sendQueue.Dequeue(buffer, 0, _sendQueue.Length);
-            return _client.Send(buffer, buffer.Length, _packetEndpoint);
+            int length = _sendLength;
+            _sendLength = 0;
+            if (_client == null || _packetEndpoint == null) {
+                return 0;
+            }
+
+            if (_batchMode) {
+#pragma warning disable 618 // the IPv4 address in network byte order, without allocating its bytes
+                uint address = (uint)_packetEndpoint.Address.Address;
+#pragma warning restore 618
+                if (!_sendPackets.TryPut(_sendBuffer, length, address, (ushort)_packetEndpoint.Port)) {
+                    return 0;
+                }
+                _reactor.Wake();
+                return length;
+            }
+
+            try {
+                return _client.Client.SendTo(_sendBuffer, 0, length, SocketFlags.None, _packetEndpoint);
+            } catch (Exception e) {
+                // e.g. WouldBlock, the socket is non-blocking and its send buffer is full
+                setExceptionMessage(e);
+                return 0;
+            }
+        }
+
+        /// <summary>
+        /// Send a packet written in place by native code.
+        /// </summary>
+        /// <param name="length">number of bytes written to the datagram buffer.</param>
+        /// <returns>0 if FAILURE or the number of bytes sent.</returns>
+        public int endPacket(int length)
+        {
+            _sendLength = Math.Max(0, Math.Min(length, _sendBuffer.Length));
+            return endPacket();
         }
 
         private void setExceptionMessage(Exception e)
@@ -184,64 +285,85 @@ namespace VirtualHardwareNet
             }
         }
 
-        private void handleClient(object obj)
+        Socket IEthernetReactorSocket.Socket
+        {
+            get { return _client.Client; }
+        }
+
+        bool IEthernetReactorSocket.WantsRead
+        {
+            get { return true; }
+        }
+
+        bool IEthernetReactorSocket.WantsWrite
+        {
+            get { return _sendPackets != null && _sendPackets.Count > 0; }
+        }
+
+        void IEthernetReactorSocket.OnReadable()
         {
             try {
-                var client = obj as UdpClient;
-                int count;
-                while (_treadActive) {
-                    if (client.Available > 0) {
-                        IPEndPoint remoteEP = new IPEndPoint(IPAddress.Any, 0);
-                        byte[] buffer = client.Receive(ref remoteEP);
-                        count = buffer.Length;
-                        if (count > 0) {
-                            ReceiveResult result = new ReceiveResult(buffer, remoteEP);
-                            lock (_receivedPackets) {
-                                _receivedPackets.Enqueue(result);
-                            }
-                        }
+                // all datagrams pending, one readiness notification of the reactor for many packets
+                Socket socket = _client.Client;
+                while (socket.Available > 0) {
+                    int length = socket.ReceiveFrom(_receiveBuffer, ref _receiveEndPoint);
+                    if (length > 0) {
+                        var ep = (IPEndPoint)_receiveEndPoint;
+#pragma warning disable 618 // the IPv4 address in network byte order, without allocating its bytes
+                        uint address = (uint)ep.Address.Address;
+#pragma warning restore 618
+                        _receivedPackets.TryPut(_receiveBuffer, length, address, (ushort)ep.Port);
                     }
-                    // prevent high CPU usage
-                    Thread.Sleep(10);
                 }
             } catch (Exception e) {
                 setExceptionMessage(e);
-            } finally {
-                _mreHandleClient.Set();
             }
         }
 
-        public int parsePacket(out uint remoteIpAddress, out ushort remotePort)
+        void IEthernetReactorSocket.OnWritable()
         {
-            Thread.Yield();
-
-            int packetLength = 0;
-            remoteIpAddress = 0;
-            remotePort = 0;
-            ReceiveResult result = new ReceiveResult();
-
-            lock (_receivedPackets) {
-                if (_receivedPackets.Count > 0) {
-                    result = _receivedPackets.Dequeue();
-                } else {
-                    return packetLength;
+            IntPtr data;
+            int length;
+            uint address;
+            ushort port;
+            try {
+                while (_sendPackets.TryTake(out data, out length, out address, out port)) {
+#pragma warning disable 618
+                    if (_batchEndpoint == null || (uint)_batchEndpoint.Address.Address != address || _batchEndpoint.Port != port) {
+#pragma warning restore 618
+                        _batchEndpoint = new IPEndPoint(address, port);
+                    }
+                    Marshal.Copy(data, _batchBuffer, 0, length);
+                    _client.Client.SendTo(_batchBuffer, 0, length, SocketFlags.None, _batchEndpoint);
                 }
+            } catch (Exception e) {
+                setExceptionMessage(e);
             }
+        }
 
-            if (result.RemoteEndPoint != null) {
-                var ep = result.RemoteEndPoint;
-                var bytes = ep.Address.GetAddressBytes();
-                remoteIpAddress = BitConverter.ToUInt32(bytes, 0);
-                remotePort = (ushort)ep.Port;
-            }
-            if (result.Buffer != null) {
-                packetLength = result.Buffer.Length;
-            }
+        public int parsePacket(out uint remoteIpAddress, out ushort remotePort)
+        {
+            Thread.Yield();
 
-            _receiveQueue.Clear();
-            _receiveQueue.Enqueue(result.Buffer, 0, packetLength);
+            IntPtr data;
+            return parsePacket(out remoteIpAddress, out remotePort, out data);
+        }
 
-            return packetLength;
+        /// <summary>
+        /// Start processing the next received packet, which is read in place.
+        /// </summary>
+        /// <param name="remoteIpAddress">of the sender.</param>
+        /// <param name="remotePort">of the sender.</param>
+        /// <param name="data">the payload, valid until the next parsePacket or close.</param>
+        /// <returns>0 if no packet or the size of the packet.</returns>
+        public int parsePacket(out uint remoteIpAddress, out ushort remotePort, out IntPtr data)
+        {
+            if (!_receivedPackets.TryTake(out _packetData, out _packetLength, out remoteIpAddress, out remotePort)) {
+                _packetLength = 0;
+            }
+            _packetPosition = 0;
+            data = _packetData;
+            return _packetLength;
         }
 
         /// <summary>
@@ -256,11 +378,9 @@ namespace VirtualHardwareNet
                 return 0;
             }
 
-            int length = 128 - _sendQueue.Length;
-            if (size > length) {
-                size = (uint)length;
-            }
-            _sendQueue.Enqueue(buf, 0, (int)size);
+            size = Math.Min(size, (uint)(_sendBuffer.Length - _sendLength));
+            Buffer.BlockCopy(buf, 0, _sendBuffer, _sendLength, (int)size);
+            _sendLength += (int)size;
 
             Thread.Yield();
 
@@ -278,10 +398,32 @@ namespace VirtualHardwareNet
             Thread.Yield();
 
             int result = -1;
-            int length = _receiveQueue.Length;
+            int length = _packetLength - _packetPosition;
             length = bytes > length ? length : (int)bytes;
             if (length > 0) {
-                result = _receiveQueue.Dequeue(buf, 0, length);
+                Marshal.Copy(_packetData + _packetPosition, buf, 0, length);
+                _packetPosition += length;
+                result = length;
+            }
+
+            return result;
+        }
+
+        /// <summary>
+        /// Read a number of bytes of the current packet directly into caller memory.
+        /// </summary>
+        /// <param name="buf">Pointer to the memory to write to.</param>
+        /// <param name="bytes">number of bytes to read.</param>
+        /// <returns>-1 if no data or number of read bytes.</returns>
+        public unsafe int read(byte* buf, uint bytes)
+        {
+            int result = -1;
+            int length = _packetLength - _packetPosition;
+            length = bytes > length ? length : (int)bytes;
+            if (length > 0) {
+                Buffer.MemoryCopy((byte*)(_packetData + _packetPosition), buf, length, length);
+                _packetPosition += length;
+                result = length;
             }
 
             return result;
@@ -296,8 +438,8 @@ namespace VirtualHardwareNet
             Thread.Yield();
 
             int result = -1;
-            if (_receiveQueue.Length > 0) {
-                result = _receiveQueue.Peek();
+            if (_packetPosition < _packetLength) {
+                result = Marshal.ReadByte(_packetData, _packetPosition);
             }
 
             return result;
@@ -309,18 +451,19 @@ namespace VirtualHardwareNet
         public void close()
         {
             if (_client != null) {
-                // signal and wait for thread handleClient() has finished
-                _treadActive = false;
-                _mreHandleClient.WaitOne();
+                // wait until the reactor no longer uses the socket
+                _reactor.Unregister(this);
 
                 _client.Close();
                 _client = null;
 
                 _receivedPackets.Clear();
-                _receiveQueue.Clear();
-                _sendQueue.Clear();
+                _packetData = IntPtr.Zero;
+                _packetLength = 0;
+                _packetPosition = 0;
+                _sendLength = 0;
+                _sendPackets?.Clear();
 
-                Allocated = false;
                 // Wait a moment to let Windows close the client
                 Thread.Sleep(1);
             }
@@ -334,8 +477,13 @@ namespace VirtualHardwareNet
         {
             if (!disposedValue) {
                 if (disposing) {
-                    _client.Close();
-                    _client = null;
+                    // the reactor must no longer receive into the ring
+                    close();
+                    _receivedPackets.Dispose();
+                    _sendPackets?.Dispose();
+                }
+                if (_sendHandle.IsAllocated) {
+                    _sendHandle.Free();
                 }
                 disposedValue = true;
             }
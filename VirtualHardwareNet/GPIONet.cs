@@ -39,6 +39,28 @@ namespace VirtualHardwareNet
     {
         private GPIO _gpio;
 
+        // Port numbers of the AVR core, with the Arduino pins of their bits
+        private const byte PortB = 2;
+        private const byte PortC = 3;
+        private const byte PortD = 4;
+
+        // Last level written to the pins 0 to 31, valid for the bits of _outputsKnown
+        private uint _outputs;
+        private uint _outputsKnown;
+
+        // Changes collected between BeginTransaction() and CommitTransaction()
+        private bool _transaction;
+        private uint _pendingMask;
+        private uint _pendingValues;
+
+        // IO-Warrior pin of the Arduino pins 0 to 31, NoPin if the device has none
+        private const byte NoPin = 255;
+        private const int MaxPins = 32;
+        private byte[] _pinTable = _createPinTable(null);
+
+        // Copy of the pin table, built by Begin() for the connected device
+        public byte[] PinTable => (byte[])_pinTable.Clone();
+
         public void Begin(string serialNumber)
         {
             IOW.Connect(serialNumber);
@@ -49,10 +71,14 @@ namespace VirtualHardwareNet
                 Console.WriteLine("No GPIO capable IO-Warrior detected!");
                 return;
             }
+            _pinTable = _createPinTable(IOW.Device);
         }
 
         public void End()
         {
+            _outputsKnown = 0;
+            _transaction = false;
+            _pinTable = _createPinTable(null);
             if (IOW.Device != null)
             {
                 IOW.Disconnect();
@@ -77,58 +103,183 @@ namespace VirtualHardwareNet
 
         public byte DigitalRead(byte pin)
         {
-            if (_gpio != null)
+            return DigitalReadIow(_mapPin(pin));
+        }
+
+        public void DigitalWrite(byte pin, byte value)
+        {
+            if (pin < 32)
             {
-                byte iowPin = _mapPin(pin);
-                if (iowPin < 255)
-                {
-                    return (byte)(_gpio.DigitalRead(iowPin) == PinState.LOW ? 0 : 1);
-                }
+                uint bit = 1u << pin;
+                DigitalWriteMask(bit, value == 0 ? 0 : bit);
             }
-            return 0;
         }
 
-        public void DigitalWrite(byte pin, byte value)
+        // Writes the pins 0 to 31 in mask to the levels of their bits in values
+        public void DigitalWriteMask(uint mask, uint values)
+        {
+            _pendingMask |= mask;
+            _pendingValues = (_pendingValues & ~mask) | (values & mask);
+            if (!_transaction)
+            {
+                _writePending();
+            }
+        }
+
+        public uint DigitalReadMask(uint mask)
         {
-            if (_gpio != null)
+            uint values = 0;
+            for (byte pin = 0; pin < MaxPins; pin++)
             {
-                byte iowPin = _mapPin(pin);
-                if (iowPin < 255)
+                if ((mask & (1u << pin)) != 0 && DigitalRead(pin) != 0)
                 {
-                    _gpio.DigitalWrite(iowPin, value == 0 ?  PinState.LOW : PinState.HIGH);
+                    values |= 1u << pin;
                 }
             }
+            return values;
         }
 
         public void DigitalWritePort(byte port, byte value)
         {
-            throw new NotImplementedException();
+            byte first, count;
+            if (_portPins(port, out first, out count))
+            {
+                uint mask = ((1u << count) - 1) << first;
+                DigitalWriteMask(mask, (uint)value << first);
+            }
+        }
+
+        public byte DigitalReadPort(byte port)
+        {
+            byte first, count;
+            if (!_portPins(port, out first, out count))
+            {
+                return 0;
+            }
+            return (byte)(DigitalReadMask(((1u << count) - 1) << first) >> first);
+        }
+
+        // Collects the pin changes until CommitTransaction(), a pin written several times
+        // is written once with its last level, a pin at its known level not at all
+        public void BeginTransaction()
+        {
+            _transaction = true;
+        }
+
+        public void CommitTransaction()
+        {
+            _transaction = false;
+            _writePending();
         }
 
         public ushort AnalogRead(byte pin)
         {
-            throw new NotImplementedException();
+            // the analog inputs of the IO-Warrior are not supported
+            return 0;
         }
 
         public void AnalogWrite(byte pin, ushort value)
         {
-            throw new NotImplementedException();
+            // no PWM on the IO-Warrior pins, like an Arduino pin without PWM
+            DigitalWrite(pin, (byte)(value < 128 ? 0 : 1));
         }
 
-        private byte _mapPin(byte pin)
+        // IO-Warrior pins from PinTable, for a caller that translates the Arduino pins and
+        // keeps the levels of the outputs itself, bypass the transaction and the shadow above
+        public byte DigitalReadIow(byte iowPin)
+        {
+            if (_gpio == null || iowPin == NoPin)
+            {
+                return 0;
+            }
+            return (byte)(_gpio.DigitalRead(iowPin) == PinState.LOW ? 0 : 1);
+        }
+
+        public void DigitalWriteIow(byte iowPin, byte value)
+        {
+            if (_gpio != null && iowPin != NoPin)
+            {
+                _gpio.DigitalWrite(iowPin, value == 0 ? PinState.LOW : PinState.HIGH);
+            }
+        }
+
+        public void AnalogWriteIow(byte iowPin, ushort value)
+        {
+            // no PWM, like AnalogWrite()
+            DigitalWriteIow(iowPin, (byte)(value < 128 ? 0 : 1));
+        }
+
+        private void _writePending()
         {
-            if (IOW.Device is IOWarrior56)
+            uint changed = _pendingMask & ~(_outputsKnown & ~(_outputs ^ _pendingValues));
+            _pendingMask = 0;
+            if (_gpio == null || changed == 0)
             {
-                return _mapIOWarrior56Pin(pin);
+                return;
             }
-            else if (IOW.Device is IOWarrior28)
+            for (byte pin = 0; pin < MaxPins; pin++)
             {
-                return _mapIOWarrior28Pin(pin); 
+                uint bit = 1u << pin;
+                if ((changed & bit) == 0)
+                {
+                    continue;
+                }
+                DigitalWriteIow(_mapPin(pin), (byte)((_pendingValues & bit) == 0 ? 0 : 1));
+            }
+            _outputs = (_outputs & ~changed) | (_pendingValues & changed);
+            _outputsKnown |= changed;
+        }
+
+        private static bool _portPins(byte port, out byte first, out byte count)
+        {
+            switch (port)
+            {
+                case PortB:
+                    first = 8;
+                    count = 6;
+                    return true;
+                case PortC: // A0 to A5
+                    first = 14;
+                    count = 6;
+                    return true;
+                case PortD:
+                    first = 0;
+                    count = 8;
+                    return true;
+                default:
+                    first = 0;
+                    count = 0;
+                    return false;
+            }
+        }
+
+        private byte _mapPin(byte pin)
+        {
+            return pin < MaxPins ? _pinTable[pin] : NoPin;
+        }
+
+        private static byte[] _createPinTable(IOWarrior device)
+        {
+            byte[] table = new byte[MaxPins];
+            for (byte pin = 0; pin < MaxPins; pin++)
+            {
+                if (device is IOWarrior56)
+                {
+                    table[pin] = _mapIOWarrior56Pin(pin);
+                }
+                else if (device is IOWarrior28)
+                {
+                    table[pin] = _mapIOWarrior28Pin(pin);
+                }
+                else
+                {
+                    table[pin] = NoPin;
+                }
             }
-            return 255;
+            return table;
         }
 
-        private byte _mapIOWarrior28Pin(byte pin)
+        private static byte _mapIOWarrior28Pin(byte pin)
         {
             switch (pin)
             {
@@ -175,7 +326,7 @@ namespace VirtualHardwareNet
             }
         }
 
-        private byte _mapIOWarrior56Pin(byte pin)
+        private static byte _mapIOWarrior56Pin(byte pin)
         {
             switch (pin)
             {
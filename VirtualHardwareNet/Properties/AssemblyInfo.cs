@@ -19,6 +19,9 @@ using System.Runtime.InteropServices;
 // COM aus zugreifen müssen, sollten Sie das ComVisible-Attribut für diesen Typ auf "True" festlegen.
 [assembly: ComVisible(false)]
 
+// Die Benchmarks in TestVirtualHardwareNet greifen auf die internen Queue-Methoden zu.
+[assembly: InternalsVisibleTo("TestVirtualHardwareNet")]
+
 // Die folgende GUID bestimmt die ID der Typbibliothek, wenn dieses Projekt für COM verfügbar gemacht wird
 [assembly: Guid("2d5f5046-6d20-426b-86a1-921ceeec8c76")]
 
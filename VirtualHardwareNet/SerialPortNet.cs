@@ -27,7 +27,7 @@
 */
 
 using System;
-using System.Collections;
+using System.Diagnostics;
 using System.IO.Ports;
 using System.Text;
 using System.Threading;
@@ -36,10 +36,22 @@ namespace VirtualHardwareNet
 {
     public class SerialPortNet : IDisposable
     {
+        private const int _constBufferSize = 128;
+        private const int _constMaxBufferSize = 1 << 20;
+        // safety net only, handleSerialPort() is woken by _areWakeSerialPort
+        private const int _constIdleTimeout = 100;
         private SerialPort  _serialPort;
-        private ByteQueue _receiveQueue = new ByteQueue();
-        private ByteQueue _sendQueue = new ByteQueue();
+        private SpscByteQueue _receiveQueue = new SpscByteQueue(_constBufferSize);
+        private SpscByteQueue _sendQueue = new SpscByteQueue(_constBufferSize);
         private readonly ManualResetEvent _mreHandleSerialPort = new ManualResetEvent(false);
+        // signaled on received data, on new send data and on end()
+        private readonly AutoResetEvent _areWakeSerialPort = new AutoResetEvent(false);
+        // 1 while handleSerialPort() waits or is about to wait for _areWakeSerialPort
+        private int _threadIdle;
+        // signaled by handleSerialPort() when it made room in the send queue for a blocked write()
+        private readonly AutoResetEvent _areSendQueueSpace = new AutoResetEvent(false);
+        private int _writerWaiting;
+        private uint _writeTimeout;
 
         private volatile bool _threadActive;
 
@@ -52,6 +64,43 @@ namespace VirtualHardwareNet
         {
         }
 
+        /// <summary>
+        /// Set the size of the receive buffer, must be called before begin().
+        /// </summary>
+        /// <param name="size">new size in bytes, rounded up to a power of two.</param>
+        /// <returns>0 if FAILURE or the new size of the buffer.</returns>
+        public uint setRxBufferSize(uint size)
+        {
+            if (_serialPort != null || size == 0 || size > _constMaxBufferSize)
+                return 0;
+
+            _receiveQueue = new SpscByteQueue((int)size);
+            return (uint)_receiveQueue.Capacity;
+        }
+
+        /// <summary>
+        /// Set the size of the send buffer, must be called before begin().
+        /// </summary>
+        /// <param name="size">new size in bytes, rounded up to a power of two.</param>
+        /// <returns>0 if FAILURE or the new size of the buffer.</returns>
+        public uint setTxBufferSize(uint size)
+        {
+            if (_serialPort != null || size == 0 || size > _constMaxBufferSize)
+                return 0;
+
+            _sendQueue = new SpscByteQueue((int)size);
+            return (uint)_sendQueue.Capacity;
+        }
+
+        /// <summary>
+        /// Set how long write() waits for room in a full send buffer.
+        /// </summary>
+        /// <param name="milliseconds">maximum time to block, 0 to return immediately with the bytes that fit.</param>
+        public void setWriteTimeout(uint milliseconds)
+        {
+            _writeTimeout = milliseconds;
+        }
+
         /// <summary>
         /// 
         /// </summary>
@@ -69,6 +118,8 @@ namespace VirtualHardwareNet
             try
             {
                 serialPort = new SerialPort(portName, baudRate, parity, dataBits, stopBits);
+                serialPort.ReadBufferSize = Math.Max(serialPort.ReadBufferSize, _receiveQueue.Capacity);
+                serialPort.DataReceived += serialPort_DataReceived;
                 serialPort.Open();
             }
             catch ////(Exception e)
@@ -78,6 +129,7 @@ namespace VirtualHardwareNet
             }
             _serialPort = serialPort;
             _threadActive = true;
+            _mreHandleSerialPort.Reset();
 
             var serialPortThread = new Thread(new ParameterizedThreadStart(handleSerialPort));
             serialPortThread.Start(_serialPort);
@@ -90,30 +142,41 @@ namespace VirtualHardwareNet
             try
             {
                 var serialPort = obj as SerialPort;
-                byte[] buffer = new byte[128];
+                byte[] buffer = new byte[Math.Max(_receiveQueue.Capacity, _sendQueue.Capacity)];
                 int count;
                 while (_threadActive)
                 {
-                    if (serialPort.BytesToRead > 0)
+                    bool receiveQueueFull = false;
+                    while (serialPort.BytesToRead > 0)
                     {
-                        int length = buffer.Length - _receiveQueue.Length;
-                        count = serialPort.Read(buffer, 0, length);
-                        if (count > 0)
+                        int length = Math.Min(buffer.Length, _receiveQueue.Free);
+                        if (length == 0)
                         {
-                            _receiveQueue.Enqueue(buffer, 0, count);
+                            // the sketch has to read first, no event tells us when
+                            receiveQueueFull = true;
+                            break;
                         }
+                        count = serialPort.Read(buffer, 0, length);
+                        _receiveQueue.Enqueue(buffer, 0, count);
                     }
 
-                    count = _sendQueue.Length;
-                    if (count > 0)
+                    while ((count = _sendQueue.Dequeue(buffer, 0, buffer.Length)) > 0)
                     {
-                        if (count > buffer.Length)
-                            count = buffer.Length;
-                        _sendQueue.Dequeue(buffer, 0, count);
+                        if (Interlocked.CompareExchange(ref _writerWaiting, 0, 1) == 1)
+                        {
+                            _areSendQueueSpace.Set();
+                        }
                         serialPort.Write(buffer, 0, count);
                     }
-                    // prevent high CPU usage
-                    Thread.Sleep(10);
+
+                    // announce the wait before checking the send queue a last time,
+                    // write() sets the event only if it sees _threadIdle == 1
+                    Interlocked.Exchange(ref _threadIdle, 1);
+                    if (_sendQueue.Length == 0 && _threadActive)
+                    {
+                        _areWakeSerialPort.WaitOne(receiveQueueFull ? 1 : _constIdleTimeout);
+                    }
+                    Interlocked.Exchange(ref _threadIdle, 0);
                 }
             }
             catch ////(Exception e)
@@ -126,14 +189,27 @@ namespace VirtualHardwareNet
             }
         }
 
+        private void serialPort_DataReceived(object sender, SerialDataReceivedEventArgs e)
+        {
+            _areWakeSerialPort.Set();
+        }
+
+        private void wakeSerialPort()
+        {
+            if (Interlocked.CompareExchange(ref _threadIdle, 0, 1) == 1)
+            {
+                _areWakeSerialPort.Set();
+            }
+        }
+
         /// <summary>
         /// Write a byte.
         /// </summary>
         /// <param name="b">byte to write.</param>
         /// <returns>0 if FAILURE or 1 if SUCCESS.</returns>
-        public uint write(byte b)
+        public unsafe uint write(byte b)
         {
-            return write(new byte[] { b }, 1);
+            return write(&b, 1);
         }
 
         /// <summary>
@@ -142,21 +218,63 @@ namespace VirtualHardwareNet
         /// <param name="buf">Buffer to read from.</param>
         /// <param name="size">of the buffer.</param>
         /// <returns>0 if FAILURE or the number of bytes sent.</returns>
-        public uint write(byte[] buf, uint size)
+        public unsafe uint write(byte[] buf, uint size)
         {
             if (size == 0)
                 return 0;
 
-            int length = 128 - _sendQueue.Length;
-            if (size > length)
+            fixed (byte* p = buf)
             {
-                size = (uint)length;
+                return write(p, size);
+            }
+        }
+
+        /// <summary>
+        /// Write at most 'size' bytes directly from caller memory.
+        /// </summary>
+        /// <param name="buf">Pointer to the bytes to send.</param>
+        /// <param name="size">of the buffer.</param>
+        /// <returns>0 if FAILURE or the number of bytes sent.</returns>
+        public unsafe uint write(byte* buf, uint size)
+        {
+            if (size == 0)
+                return 0;
+
+            uint sent = (uint)_sendQueue.Enqueue(buf, (int)size);
+            wakeSerialPort();
+
+            if (sent < size && _writeTimeout > 0 && _serialPort != null)
+            {
+                sent += writeBlocking(buf + sent, size - sent);
             }
-            _sendQueue.Enqueue(buf, 0, (int)size);
 
             Thread.Yield();
 
-            return size;
+            return sent;
+        }
+
+        private unsafe uint writeBlocking(byte* buf, uint size)
+        {
+            uint sent = 0;
+            var stopwatch = Stopwatch.StartNew();
+            while (sent < size)
+            {
+                long remainingMillis = _writeTimeout - stopwatch.ElapsedMilliseconds;
+                if (remainingMillis <= 0)
+                    break;
+
+                // same handshake as _threadIdle, announce the wait before checking a last time
+                Interlocked.Exchange(ref _writerWaiting, 1);
+                if (_sendQueue.Free == 0)
+                {
+                    _areSendQueueSpace.WaitOne((int)remainingMillis);
+                }
+                Interlocked.Exchange(ref _writerWaiting, 0);
+
+                sent += (uint)_sendQueue.Enqueue(buf + sent, (int)(size - sent));
+                wakeSerialPort();
+            }
+            return sent;
         }
 
         /// <summary>
@@ -185,16 +303,16 @@ namespace VirtualHardwareNet
         /// Read a byte.
         /// </summary>
         /// <returns>-1 if no data, else the first byte available.</returns>
-        public int read()
+        public unsafe int read()
         {
             Thread.Yield();
 
             int result = -1;
-            byte[] buffer = new byte[1];
+            byte b;
             if (_receiveQueue.Length > 0)
             {
-                if (_receiveQueue.Dequeue(buffer, 0, 1) == 1)
-                    result = buffer[0];
+                if (_receiveQueue.Dequeue(&b, 1) == 1)
+                    result = b;
             }
 
             return result;
@@ -221,6 +339,27 @@ namespace VirtualHardwareNet
             return result;
         }
 
+        /// <summary>
+        /// Read a number of bytes directly into caller memory.
+        /// </summary>
+        /// <param name="buf">Pointer to the memory to write to.</param>
+        /// <param name="bytes">number of bytes to read.</param>
+        /// <returns>-1 if no data or number of read bytes.</returns>
+        public unsafe int read(byte* buf, uint bytes)
+        {
+            Thread.Yield();
+
+            int result = -1;
+            int length = _receiveQueue.Length;
+            length = bytes > length ? length : (int)bytes;
+            if (length > 0)
+            {
+                result = _receiveQueue.Dequeue(buf, length);
+            }
+
+            return result;
+        }
+
         /// <summary>
         /// Returns the next byte of the read queue without removing it from the queue.
         /// </summary>
@@ -265,8 +404,10 @@ namespace VirtualHardwareNet
             {
                 // signal and wait for thread handleSerialPort() has finished
                 _threadActive = false;
+                _areWakeSerialPort.Set();
                 _mreHandleSerialPort.WaitOne();
 
+                _serialPort.DataReceived -= serialPort_DataReceived;
                 _serialPort.Close();
                 _serialPort = null;
 
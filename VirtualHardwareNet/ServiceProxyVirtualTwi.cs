@@ -86,17 +86,17 @@ namespace VirtualHardwareNet
             }
         }
 
-        public byte readFrom(byte address, ref byte[] rxBuffer, byte quantity, bool sendStop)
+        public byte readFrom(byte address, ref byte[] rxBuffer, byte quantity, bool sendStop, uint timeout)
         {
             try
             {
-                return Channel.readFrom(address, ref rxBuffer, quantity, sendStop);
+                return Channel.readFrom(address, ref rxBuffer, quantity, sendStop, timeout);
             }
             catch (Exception ex)
             {
                 displayExceptionAndStop(ex);
             }
-            return 4;
+            return 0;
         }
 
         public byte writeTo(byte txAddress, byte[] txBuffer, byte txBufferLength, bool wait, bool sendStop)
@@ -112,18 +112,6 @@ namespace VirtualHardwareNet
             return 4;
         }
 
-        public void transmit(byte[] data, uint quantity)
-        {
-            try
-            {
-                Channel.transmit(data, quantity);
-            }
-            catch (Exception ex)
-            {
-                displayExceptionAndStop(ex);
-            }
-        }
-
         private void displayExceptionAndStop(Exception ex)
         {
             Console.WriteLine("Exception Type: {0}\nDescription: {1}", ex.GetType(), ex.Message);
@@ -38,12 +38,11 @@ namespace VirtualHardwareNet
     [CallbackBehavior(UseSynchronizationContext = false)]
     public class ServiceVirtualTwiCallback : IServiceVirtualTwiCallback
     {
-        public delegate void TxEventDelegate();
+        public delegate byte[] TxEventDelegate(byte quantity);
         public delegate void RxEventDelegate(byte[] data, uint quantity);
 
         public event TxEventDelegate SlaveTxEvent;
         public event RxEventDelegate SlaveRxEvent;
-        public event RxEventDelegate MasterRxEvent;
 
         public void SlaveRxCallback(byte[] data, uint quantity)
         {
@@ -51,16 +50,11 @@ namespace VirtualHardwareNet
                 SlaveRxEvent(data, quantity);
         }
 
-        public void SlaveTxCallback()
+        public byte[] SlaveTxCallback(byte quantity)
         {
             if (SlaveTxEvent != null)
-                SlaveTxEvent();
-        }
-
-        public void MasterRxCallback(byte[] data, uint quantity)
-        {
-            if (MasterRxEvent != null)
-                MasterRxEvent(data, quantity);
+                return SlaveTxEvent(quantity);
+            return new byte[0];
         }
 
         public void Ping()
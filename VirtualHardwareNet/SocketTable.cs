@@ -0,0 +1,140 @@
+﻿/*
+  SocketTable.cs - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+using System;
+
+namespace VirtualHardwareNet
+{
+    /// <summary>
+    /// Socket number allocator with a fixed number of slots. Free slots form a linked list,
+    /// so Allocate() and Release() are O(1). The slot objects are kept and reused after Release().
+    /// Not thread safe, the owner has to lock.
+    /// </summary>
+    internal sealed class SocketTable<T> where T : class
+    {
+        private T[] _slots;
+        // next free slot for every free slot, -1 ends the list
+        private int[] _nextFree;
+        private bool[] _inUse;
+        private int _freeHead;
+
+        public SocketTable(int capacity)
+        {
+            resize(capacity);
+        }
+
+        /// <summary>
+        /// Gets the number of slots, valid socket numbers are 0 to Capacity - 1
+        /// </summary>
+        public int Capacity
+        {
+            get { return _slots.Length; }
+        }
+
+        /// <summary>
+        /// Gets the number of allocated slots
+        /// </summary>
+        public int Count { get; private set; }
+
+        /// <summary>
+        /// Gets or sets the object of a slot, allocated or not
+        /// </summary>
+        public T this[int socketNumber]
+        {
+            get { return _slots[socketNumber]; }
+            set { _slots[socketNumber] = value; }
+        }
+
+        public bool IsValid(int socketNumber)
+        {
+            return socketNumber >= 0 && socketNumber < _slots.Length;
+        }
+
+        /// <summary>
+        /// Change the number of slots, only while no slot is allocated.
+        /// </summary>
+        /// <returns>true if SUCCESS</returns>
+        public bool Resize(int capacity)
+        {
+            if (Count > 0 || capacity <= 0) {
+                return false;
+            }
+            resize(capacity);
+            return true;
+        }
+
+        private void resize(int capacity)
+        {
+            var slots = new T[capacity];
+            if (_slots != null) {
+                Array.Copy(_slots, slots, Math.Min(_slots.Length, capacity));
+            }
+            _slots = slots;
+            _nextFree = new int[capacity];
+            _inUse = new bool[capacity];
+
+            // lowest socket numbers first, like the former linear scan
+            for (int i = 0; i < capacity; i++) {
+                _nextFree[i] = i + 1 < capacity ? i + 1 : -1;
+            }
+            _freeHead = 0;
+        }
+
+        /// <summary>
+        /// Take a free slot.
+        /// </summary>
+        /// <returns>-1 if all slots are allocated or the socket number</returns>
+        public int Allocate()
+        {
+            int socketNumber = _freeHead;
+            if (socketNumber == -1) {
+                return -1;
+            }
+            _freeHead = _nextFree[socketNumber];
+            _inUse[socketNumber] = true;
+            Count++;
+            return socketNumber;
+        }
+
+        /// <summary>
+        /// Return a slot to the free list, releasing a free slot again is ignored.
+        /// </summary>
+        /// <returns>true if the slot was allocated</returns>
+        public bool Release(int socketNumber)
+        {
+            if (!IsValid(socketNumber) || !_inUse[socketNumber]) {
+                return false;
+            }
+            _inUse[socketNumber] = false;
+            _nextFree[socketNumber] = _freeHead;
+            _freeHead = socketNumber;
+            Count--;
+            return true;
+        }
+    }
+}
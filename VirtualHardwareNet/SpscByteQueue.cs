@@ -0,0 +1,278 @@
+﻿/*
+  SpscByteQueue.cs - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace VirtualHardwareNet
+{
+    /// <summary>
+    /// Fixed-capacity circular byte queue for exactly one producer and one consumer thread.
+    /// Enqueue and Dequeue never lock and never allocate, the head and tail indices live
+    /// on separate cache lines so producer and consumer do not invalidate each other.
+    /// </summary>
+    public sealed class SpscByteQueue
+    {
+        private const int CacheLineSize = 64;
+
+        [StructLayout(LayoutKind.Explicit, Size = 2 * CacheLineSize)]
+        private struct PaddedIndex
+        {
+            [FieldOffset(CacheLineSize)]
+            public int Value;
+        }
+
+        // Indices run freely and wrap around int, only (index & _mask) addresses the buffer.
+        // Written by the consumer only
+        private PaddedIndex _head;
+        // Written by the producer only
+        private PaddedIndex _tail;
+
+        private readonly byte[] _buffer;
+        private readonly int _mask;
+
+        /// <summary>
+        /// Constructs a new queue, the capacity is rounded up to the next power of two.
+        /// </summary>
+        /// <param name="capacity">Minimal number of bytes the queue can hold</param>
+        public SpscByteQueue(int capacity)
+        {
+            if (capacity <= 0 || capacity > (1 << 30))
+                throw new ArgumentOutOfRangeException("capacity");
+
+            int size = 1;
+            while (size < capacity)
+                size <<= 1;
+
+            _buffer = new byte[size];
+            _mask = size - 1;
+        }
+
+        /// <summary>
+        /// Gets the number of bytes the queue can hold
+        /// </summary>
+        public int Capacity
+        {
+            get { return _buffer.Length; }
+        }
+
+        /// <summary>
+        /// Gets the number of bytes in the queue
+        /// </summary>
+        public int Length
+        {
+            get { return Volatile.Read(ref _tail.Value) - Volatile.Read(ref _head.Value); }
+        }
+
+        /// <summary>
+        /// Gets the number of bytes which can be enqueued without being truncated
+        /// </summary>
+        public int Free
+        {
+            get { return _buffer.Length - Length; }
+        }
+
+        /// <summary>
+        /// Discards all bytes. Must be called by the consumer or while the producer is stopped.
+        /// </summary>
+        internal void Clear()
+        {
+            Volatile.Write(ref _head.Value, Volatile.Read(ref _tail.Value));
+        }
+
+        /// <summary>
+        /// Enqueues as many bytes of the buffer as fit into the queue (producer only)
+        /// </summary>
+        /// <param name="buffer">Buffer to enqueue</param>
+        /// <param name="offset">The zero-based byte offset in the buffer</param>
+        /// <param name="size">The number of bytes to enqueue</param>
+        /// <returns>Number of bytes enqueued</returns>
+        internal int Enqueue(byte[] buffer, int offset, int size)
+        {
+            int tail = _tail.Value;
+            size = Math.Min(size, _buffer.Length - (tail - Volatile.Read(ref _head.Value)));
+            if (size <= 0)
+                return 0;
+
+            int index = tail & _mask;
+            int rightLength = _buffer.Length - index;
+            if (rightLength >= size)
+            {
+                Buffer.BlockCopy(buffer, offset, _buffer, index, size);
+            }
+            else
+            {
+                Buffer.BlockCopy(buffer, offset, _buffer, index, rightLength);
+                Buffer.BlockCopy(buffer, offset + rightLength, _buffer, 0, size - rightLength);
+            }
+
+            Volatile.Write(ref _tail.Value, tail + size);
+            return size;
+        }
+
+        /// <summary>
+        /// Enqueues as many bytes of unmanaged memory as fit into the queue (producer only)
+        /// </summary>
+        /// <param name="buffer">Pointer to the first byte to enqueue</param>
+        /// <param name="size">The number of bytes to enqueue</param>
+        /// <returns>Number of bytes enqueued</returns>
+        internal unsafe int Enqueue(byte* buffer, int size)
+        {
+            int tail = _tail.Value;
+            size = Math.Min(size, _buffer.Length - (tail - Volatile.Read(ref _head.Value)));
+            if (size <= 0)
+                return 0;
+
+            int index = tail & _mask;
+            int rightLength = _buffer.Length - index;
+            if (rightLength >= size)
+            {
+                Marshal.Copy((IntPtr)buffer, _buffer, index, size);
+            }
+            else
+            {
+                Marshal.Copy((IntPtr)buffer, _buffer, index, rightLength);
+                Marshal.Copy((IntPtr)(buffer + rightLength), _buffer, 0, size - rightLength);
+            }
+
+            Volatile.Write(ref _tail.Value, tail + size);
+            return size;
+        }
+
+        /// <summary>
+        /// Dequeues up to size bytes into the buffer (consumer only)
+        /// </summary>
+        /// <param name="buffer">Destination buffer</param>
+        /// <param name="offset">The zero-based byte offset in the buffer</param>
+        /// <param name="size">The number of bytes to dequeue</param>
+        /// <returns>Number of bytes dequeued</returns>
+        internal int Dequeue(byte[] buffer, int offset, int size)
+        {
+            int head = _head.Value;
+            size = Math.Min(size, Volatile.Read(ref _tail.Value) - head);
+            if (size <= 0)
+                return 0;
+
+            int index = head & _mask;
+            int rightLength = _buffer.Length - index;
+            if (rightLength >= size)
+            {
+                Buffer.BlockCopy(_buffer, index, buffer, offset, size);
+            }
+            else
+            {
+                Buffer.BlockCopy(_buffer, index, buffer, offset, rightLength);
+                Buffer.BlockCopy(_buffer, 0, buffer, offset + rightLength, size - rightLength);
+            }
+
+            Volatile.Write(ref _head.Value, head + size);
+            return size;
+        }
+
+        /// <summary>
+        /// Dequeues up to size bytes directly into unmanaged memory (consumer only)
+        /// </summary>
+        /// <param name="buffer">Pointer to the destination memory</param>
+        /// <param name="size">The number of bytes to dequeue</param>
+        /// <returns>Number of bytes dequeued</returns>
+        internal unsafe int Dequeue(byte* buffer, int size)
+        {
+            int head = _head.Value;
+            size = Math.Min(size, Volatile.Read(ref _tail.Value) - head);
+            if (size <= 0)
+                return 0;
+
+            int index = head & _mask;
+            int rightLength = _buffer.Length - index;
+            if (rightLength >= size)
+            {
+                Marshal.Copy(_buffer, index, (IntPtr)buffer, size);
+            }
+            else
+            {
+                Marshal.Copy(_buffer, index, (IntPtr)buffer, rightLength);
+                Marshal.Copy(_buffer, 0, (IntPtr)(buffer + rightLength), size - rightLength);
+            }
+
+            Volatile.Write(ref _head.Value, head + size);
+            return size;
+        }
+
+        /// <summary>
+        /// Gets the contiguous free space behind the tail, e.g. to receive from a socket in place (producer only)
+        /// </summary>
+        /// <returns>Segment of the internal buffer, empty if the queue is full</returns>
+        internal ArraySegment<byte> GetWriteSegment()
+        {
+            int tail = _tail.Value;
+            int free = _buffer.Length - (tail - Volatile.Read(ref _head.Value));
+            int index = tail & _mask;
+            return new ArraySegment<byte>(_buffer, index, Math.Min(free, _buffer.Length - index));
+        }
+
+        /// <summary>
+        /// Publishes bytes written into the segment of GetWriteSegment() (producer only)
+        /// </summary>
+        /// <param name="size">The number of bytes written</param>
+        internal void CommitWrite(int size)
+        {
+            Volatile.Write(ref _tail.Value, _tail.Value + size);
+        }
+
+        /// <summary>
+        /// Gets the contiguous bytes behind the head, e.g. to send to a socket in place (consumer only)
+        /// </summary>
+        /// <returns>Segment of the internal buffer, empty if the queue is empty</returns>
+        internal ArraySegment<byte> GetReadSegment()
+        {
+            int head = _head.Value;
+            int length = Volatile.Read(ref _tail.Value) - head;
+            int index = head & _mask;
+            return new ArraySegment<byte>(_buffer, index, Math.Min(length, _buffer.Length - index));
+        }
+
+        /// <summary>
+        /// Releases bytes consumed from the segment of GetReadSegment() (consumer only)
+        /// </summary>
+        /// <param name="size">The number of bytes consumed</param>
+        internal void CommitRead(int size)
+        {
+            Volatile.Write(ref _head.Value, _head.Value + size);
+        }
+
+        /// <summary>
+        /// Returns the next byte without removing it, the queue must not be empty (consumer only)
+        /// </summary>
+        /// <returns>The byte peeked</returns>
+        public byte Peek()
+        {
+            return _buffer[_head.Value & _mask];
+        }
+    }
+}
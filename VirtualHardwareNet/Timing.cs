@@ -28,6 +28,7 @@
 
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Linq;
 using System.Text;
 using System.Threading;
@@ -35,42 +36,35 @@ using System.Threading.Tasks;
 
 namespace VirtualHardwareNet
 {
+    /// <summary>
+    /// Arduino millis() and micros() from the monotonic Stopwatch, counting from construction.
+    /// Both are converted from the elapsed ticks, so they wrap around at 2^32 like on an Arduino
+    /// and do not drift. TimingWrapper uses the native MonotonicClock instead.
+    /// </summary>
     public class Timing
     {
-        private long _lastMicrosTicks;
-        private long _lastMillisTicks;
-        private uint _lastMillis;
-        private uint _lastMicros;
-
+        private readonly long _originTicks;
 
         public Timing()
         {
-            _lastMillisTicks = DateTime.UtcNow.Ticks;
-            _lastMicrosTicks = DateTime.UtcNow.Ticks;
+            _originTicks = Stopwatch.GetTimestamp();
         }
 
         public uint Millis()
         {
-            long currentTicks = DateTime.UtcNow.Ticks;
-            long elapsedTicks = currentTicks - _lastMillisTicks;
-
-            _lastMillis += (uint)(elapsedTicks / 10000);
-
-            _lastMillisTicks = DateTime.UtcNow.Ticks;
-
-            return _lastMillis;
+            return (uint)scale(Stopwatch.GetTimestamp() - _originTicks, 1000);
         }
 
         public uint Micros()
         {
-            long currentTicks = DateTime.UtcNow.Ticks;
-            long elapsedTicks = currentTicks - _lastMicrosTicks;
-
-            _lastMicros += (uint)(elapsedTicks / 10);
-
-            _lastMicrosTicks = DateTime.UtcNow.Ticks;
+            return (uint)scale(Stopwatch.GetTimestamp() - _originTicks, 1000000);
+        }
 
-            return _lastMicros;
+        // ticks * unitsPerSecond / Stopwatch.Frequency without overflow
+        private static long scale(long ticks, long unitsPerSecond)
+        {
+            long frequency = Stopwatch.Frequency;
+            return ticks / frequency * unitsPerSecond + ticks % frequency * unitsPerSecond / frequency;
         }
     }
 }
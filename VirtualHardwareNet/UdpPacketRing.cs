@@ -0,0 +1,228 @@
+﻿/*
+  UdpPacketRing.cs - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace VirtualHardwareNet
+{
+    /// <summary>
+    /// Bounded ring of received datagrams for exactly one producer and one consumer thread.
+    /// The payloads lie in one preallocated block of unmanaged memory, so the consumer reads a
+    /// packet in place, also from native code. A datagram which finds no free slot or space is
+    /// dropped and counted, nothing is allocated after construction.
+    /// </summary>
+    public sealed class UdpPacketRing : IDisposable
+    {
+        private const int CacheLineSize = 64;
+
+        [StructLayout(LayoutKind.Explicit, Size = 2 * CacheLineSize)]
+        private struct PaddedIndex
+        {
+            [FieldOffset(CacheLineSize)]
+            public int Value;
+        }
+
+        // Slot indices run freely, only (index & _mask) addresses the slot arrays.
+        // Written by the consumer only, the slot of the packet being read stays taken
+        private PaddedIndex _head;
+        // Written by the producer only
+        private PaddedIndex _tail;
+
+        private readonly int _mask;
+        private readonly int[] _offsets;
+        private readonly int[] _lengths;
+        private readonly uint[] _addresses;
+        private readonly ushort[] _ports;
+
+        private IntPtr _memory;
+        private readonly int _capacity;
+        // Producer only, where the next payload goes
+        private int _writeOffset;
+        // Consumer only, true while the packet at _head is being read
+        private bool _reading;
+        private long _dropped;
+
+        /// <summary>
+        /// Constructs a new ring, the number of packets is rounded up to the next power of two.
+        /// </summary>
+        /// <param name="packets">Minimal number of packets the ring can hold</param>
+        /// <param name="capacity">Bytes of all payloads, at least the largest datagram</param>
+        public UdpPacketRing(int packets, int capacity)
+        {
+            if (packets <= 0 || packets > (1 << 20))
+                throw new ArgumentOutOfRangeException("packets");
+            if (capacity <= 0)
+                throw new ArgumentOutOfRangeException("capacity");
+
+            int size = 1;
+            while (size < packets)
+                size <<= 1;
+
+            _mask = size - 1;
+            _offsets = new int[size];
+            _lengths = new int[size];
+            _addresses = new uint[size];
+            _ports = new ushort[size];
+            _capacity = capacity;
+            _memory = Marshal.AllocHGlobal(capacity);
+        }
+
+        ~UdpPacketRing()
+        {
+            Dispose();
+        }
+
+        /// <summary>
+        /// Gets the number of datagrams dropped because the ring was full
+        /// </summary>
+        public long Dropped
+        {
+            get { return Interlocked.Read(ref _dropped); }
+        }
+
+        /// <summary>
+        /// Gets the number of packets in the ring, including the one being read
+        /// </summary>
+        public int Count
+        {
+            get { return Volatile.Read(ref _tail.Value) - Volatile.Read(ref _head.Value); }
+        }
+
+        /// <summary>
+        /// Discards all packets. Must be called while the producer is stopped.
+        /// </summary>
+        internal void Clear()
+        {
+            Volatile.Write(ref _head.Value, Volatile.Read(ref _tail.Value));
+            _reading = false;
+            _writeOffset = 0;
+        }
+
+        /// <summary>
+        /// Puts a datagram into the ring or counts it as dropped (producer only)
+        /// </summary>
+        /// <param name="buffer">Buffer holding the payload at offset 0</param>
+        /// <param name="length">The number of payload bytes, greater than 0</param>
+        /// <param name="address">IPv4 address of the sender in network byte order</param>
+        /// <param name="port">Port of the sender</param>
+        /// <returns>True if the datagram was put into the ring</returns>
+        internal bool TryPut(byte[] buffer, int length, uint address, ushort port)
+        {
+            int tail = _tail.Value;
+            int head = Volatile.Read(ref _head.Value);
+            int offset = -1;
+            if (tail == head)
+            {
+                // empty, nothing is being read
+                if (length <= _capacity)
+                    offset = 0;
+            }
+            else if (tail - head <= _mask)
+            {
+                // payloads are contiguous from the oldest one, a payload never ends exactly at it
+                int oldest = _offsets[head & _mask];
+                if (_writeOffset >= oldest)
+                {
+                    if (_capacity - _writeOffset >= length)
+                        offset = _writeOffset;
+                    else if (length < oldest)
+                        offset = 0;
+                }
+                else if (oldest - _writeOffset > length)
+                {
+                    offset = _writeOffset;
+                }
+            }
+            if (offset < 0)
+            {
+                Interlocked.Increment(ref _dropped);
+                return false;
+            }
+
+            Marshal.Copy(buffer, 0, _memory + offset, length);
+            int slot = tail & _mask;
+            _offsets[slot] = offset;
+            _lengths[slot] = length;
+            _addresses[slot] = address;
+            _ports[slot] = port;
+            _writeOffset = offset + length;
+
+            Volatile.Write(ref _tail.Value, tail + 1);
+            return true;
+        }
+
+        /// <summary>
+        /// Releases the packet read so far and takes the next one (consumer only). Its payload
+        /// stays valid until the next call or Clear().
+        /// </summary>
+        /// <param name="data">Pointer to the payload</param>
+        /// <param name="length">Number of payload bytes</param>
+        /// <param name="address">IPv4 address of the sender in network byte order</param>
+        /// <param name="port">Port of the sender</param>
+        /// <returns>False if no packet was received</returns>
+        internal bool TryTake(out IntPtr data, out int length, out uint address, out ushort port)
+        {
+            int head = _head.Value;
+            if (_reading)
+            {
+                head++;
+                _reading = false;
+                Volatile.Write(ref _head.Value, head);
+            }
+
+            if (Volatile.Read(ref _tail.Value) == head)
+            {
+                data = IntPtr.Zero;
+                length = 0;
+                address = 0;
+                port = 0;
+                return false;
+            }
+
+            int slot = head & _mask;
+            data = _memory + _offsets[slot];
+            length = _lengths[slot];
+            address = _addresses[slot];
+            port = _ports[slot];
+            _reading = true;
+            return true;
+        }
+
+        public void Dispose()
+        {
+            if (_memory != IntPtr.Zero)
+            {
+                Marshal.FreeHGlobal(_memory);
+                _memory = IntPtr.Zero;
+            }
+            GC.SuppressFinalize(this);
+        }
+    }
+}
@@ -48,7 +48,12 @@ namespace VirtualHardwareNet
 
         private ServiceProxyVirtualTwi _proxy;
         private byte _address;
-        private List<byte> _rxBuffer = new List<byte>();
+        private uint _timeout = 100;
+
+        // the answer of this slave while SlaveTxEvent runs, filled by transmit()
+        private readonly object _answerLock = new object();
+        private byte[] _answer;
+        private int _answerLength;
 
         public VirtualTwiNet()
         {
@@ -62,7 +67,6 @@ namespace VirtualHardwareNet
                 var serviceCallback = new ServiceVirtualTwiCallback();
                 serviceCallback.SlaveRxEvent += ServiceCallback_SlaveRxEvent;
                 serviceCallback.SlaveTxEvent += ServiceCallback_SlaveTxEvent;
-                serviceCallback.MasterRxEvent += ServiceCallback_MasterRxEvent;
 
                 var instanceContext = new InstanceContext(serviceCallback);
                 var binding = new NetNamedPipeBinding();
@@ -104,21 +108,31 @@ namespace VirtualHardwareNet
             _proxy.Open();
         }
 
-        private void ServiceCallback_MasterRxEvent(byte[] data, uint quantity)
-        {
-            _rxBuffer.AddRange(data);
-        }
-
         private void ServiceCallback_SlaveRxEvent(byte[] data, uint quantity)
         {
             if (SlaveRxEvent != null)
                 SlaveRxEvent(data, quantity);
         }
 
-        private void ServiceCallback_SlaveTxEvent()
+        private byte[] ServiceCallback_SlaveTxEvent(byte quantity)
         {
-            if (SlaveTxEvent != null)
-                SlaveTxEvent();
+            lock (_answerLock)
+            {
+                var answer = new byte[quantity];
+                _answer = answer;
+                _answerLength = 0;
+                try
+                {
+                    if (SlaveTxEvent != null)
+                        SlaveTxEvent();
+                }
+                finally
+                {
+                    _answer = null;
+                }
+                Array.Resize(ref answer, _answerLength);
+                return answer;
+            }
         }
 
         public void init()
@@ -145,27 +159,23 @@ namespace VirtualHardwareNet
             getProxy().setFrequency(clock);
         }
 
-        public byte readFrom(byte address, ref byte[] rxBuffer, byte quantity, bool sendStop)
+        // Maximal time in milliseconds a slave may take to answer readFrom()
+        public void setTimeout(uint milliseconds)
         {
-            _rxBuffer.Clear();
-
-            var res = getProxy().readFrom(address, ref rxBuffer, quantity, sendStop);
-
-            var loops = 0;
-            while (_rxBuffer.Count < quantity && loops < 10)
-            {
-                Thread.Sleep(10);
-                loops++;
-            }
-
-            var bufferCount = _rxBuffer.Count;
-            bufferCount = bufferCount > quantity ? quantity : bufferCount;
+            _timeout = milliseconds;
+        }
 
-            for (int i = 0; i < bufferCount; i++)
-            {
-                rxBuffer[i] = _rxBuffer[i];
-            }
-            return quantity;
+        public byte readFrom(byte address, ref byte[] rxBuffer, byte quantity, bool sendStop)
+        {
+            // the server returns the answer of the slave in the same round trip
+            byte[] answer = null;
+            var count = getProxy().readFrom(address, ref answer, quantity, sendStop, _timeout);
+            if (answer == null)
+                return 0;
+
+            count = (byte)Math.Min(Math.Min(count, answer.Length), rxBuffer.Length);
+            Array.Copy(answer, rxBuffer, count);
+            return count;
         }
 
         public byte writeTo(byte txAddress, byte[] txBuffer, byte txBufferLength, bool wait, bool sendStop)
@@ -173,9 +183,18 @@ namespace VirtualHardwareNet
             return getProxy().writeTo(txAddress, txBuffer, txBufferLength, wait, sendStop);
         }
 
+        // Only valid while SlaveTxEvent runs, like twi_transmit()
         public void transmit(byte[] data, uint quantity)
         {
-            getProxy().transmit(data, quantity);
+            lock (_answerLock)
+            {
+                if (_answer == null)
+                    return;
+
+                var count = (int)Math.Min(quantity, (uint)(_answer.Length - _answerLength));
+                Array.Copy(data, 0, _answer, _answerLength, count);
+                _answerLength += count;
+            }
         }
 
         private ServiceProxyVirtualTwi getProxy()
@@ -0,0 +1,327 @@
+/*
+  Bme280Model.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Bme280Model.h"
+
+namespace
+{
+	enum Bme280Register
+	{
+		registerCalibration0 = 0x88,
+		registerHumidity1 = 0xa1,
+		registerChipId = 0xd0,
+		registerReset = 0xe0,
+		registerCalibration1 = 0xe1,
+		registerControlHumidity = 0xf2,
+		registerStatus = 0xf3,
+		registerControlMeasurement = 0xf4,
+		registerConfig = 0xf5,
+		registerPressure = 0xf7,
+		registerTemperature = 0xfa,
+		registerHumidity = 0xfd
+	};
+
+	const unsigned char constChipId = 0x60;
+	const unsigned char constResetCommand = 0xb6;
+	const unsigned char constStatusMeasuring = 0x08;
+	const unsigned char constModeSleep = 0x00;
+	const unsigned char constModeNormal = 0x03;
+
+	const RegisterDefinition constRegisters[] =
+	{
+		{ registerCalibration0, 26, 0x00, 0x00 },
+		{ registerChipId, 1, constChipId, 0x00 },
+		{ registerReset, 1, 0x00, 0xff },
+		{ registerCalibration1, 7, 0x00, 0x00 },
+		{ registerControlHumidity, 1, 0x00, 0x07 },
+		{ registerStatus, 1, 0x00, 0x00 },
+		{ registerControlMeasurement, 1, 0x00, 0xff },
+		{ registerConfig, 1, 0x00, 0xfd },
+		// skipped measurements read 0x80000 and 0x8000
+		{ registerPressure, 1, 0x80, 0x00 },
+		{ registerPressure + 1, 2, 0x00, 0x00 },
+		{ registerTemperature, 1, 0x80, 0x00 },
+		{ registerTemperature + 1, 2, 0x00, 0x00 },
+		{ registerHumidity, 1, 0x80, 0x00 },
+		{ registerHumidity + 1, 1, 0x00, 0x00 }
+	};
+
+	// calibration of a typical chip, the example values of the data sheet
+	const unsigned short digT1 = 27504;
+	const short digT2 = 26435;
+	const short digT3 = -1000;
+	const unsigned short digP1 = 36477;
+	const short digP2 = -10685;
+	const short digP3 = 3024;
+	const short digP4 = 2855;
+	const short digP5 = 140;
+	const short digP6 = -7;
+	const short digP7 = 15500;
+	const short digP8 = -14600;
+	const short digP9 = 6000;
+	const unsigned char digH1 = 75;
+	const short digH2 = 370;
+	const unsigned char digH3 = 0;
+	const short digH4 = 313;
+	const short digH5 = 50;
+	const signed char digH6 = 30;
+
+	// standby times of normal mode by config bits 7:5
+	const unsigned long long constStandbyMicros[8] = { 500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000 };
+
+	// The compensation formulas of the data sheet, the model searches their inverse
+
+	// 0.01 degree Celsius
+	int compensateTemperature(int adcT, int* tFine)
+	{
+		int var1 = ((((adcT >> 3) - ((int)digT1 << 1))) * ((int)digT2)) >> 11;
+		int var2 = (((((adcT >> 4) - ((int)digT1)) * ((adcT >> 4) - ((int)digT1))) >> 12) * ((int)digT3)) >> 14;
+		*tFine = var1 + var2;
+		return (*tFine * 5 + 128) >> 8;
+	}
+
+	// Pa in Q24.8
+	unsigned int compensatePressure(int adcP, int tFine)
+	{
+		long long var1 = ((long long)tFine) - 128000;
+		long long var2 = var1 * var1 * (long long)digP6;
+		var2 = var2 + ((var1 * (long long)digP5) << 17);
+		var2 = var2 + (((long long)digP4) << 35);
+		var1 = ((var1 * var1 * (long long)digP3) >> 8) + ((var1 * (long long)digP2) << 12);
+		var1 = (((((long long)1) << 47) + var1)) * ((long long)digP1) >> 33;
+		if (var1 == 0) {
+			return 0;
+		}
+		long long p = 1048576 - adcP;
+		p = (((p << 31) - var2) * 3125) / var1;
+		var1 = (((long long)digP9) * (p >> 13) * (p >> 13)) >> 25;
+		var2 = (((long long)digP8) * p) >> 19;
+		p = ((p + var1 + var2) >> 8) + (((long long)digP7) << 4);
+		return (unsigned int)p;
+	}
+
+	// %RH in Q22.10
+	unsigned int compensateHumidity(int adcH, int tFine)
+	{
+		int v = tFine - 76800;
+		v = (((((adcH << 14) - (((int)digH4) << 20) - (((int)digH5) * v)) + ((int)16384)) >> 15)
+			* (((((((v * ((int)digH6)) >> 10) * (((v * ((int)digH3)) >> 11) + ((int)32768))) >> 10)
+			+ ((int)2097152)) * ((int)digH2) + 8192) >> 14));
+		v = (v - (((((v >> 15) * (v >> 15)) >> 7) * ((int)digH1)) >> 4));
+		v = v < 0 ? 0 : v;
+		v = v > 419430400 ? 419430400 : v;
+		return (unsigned int)(v >> 12);
+	}
+
+	// oversampling setting to number of samples
+	unsigned int samples(unsigned int setting)
+	{
+		return setting == 0 ? 0 : 1u << ((setting > 5 ? 5 : setting) - 1);
+	}
+}
+
+Bme280Model::Bme280Model()
+	: TwiRegisterDevice(constRegisters, sizeof(constRegisters) / sizeof(constRegisters[0]), 1),
+	_celsius(20.0), _pascal(101325.0), _relativeHumidity(50.0),
+	_measuring(false), _measurementStart(0), _measurementEnd(0)
+{
+	reset();
+}
+
+void Bme280Model::setEnvironment(double celsius, double pascal, double relativeHumidity)
+{
+	_celsius = celsius;
+	_pascal = pascal;
+	_relativeHumidity = relativeHumidity;
+}
+
+void Bme280Model::reset()
+{
+	registers.reset();
+	_measuring = false;
+
+	const unsigned short words[12] = { digT1, (unsigned short)digT2, (unsigned short)digT3, digP1,
+		(unsigned short)digP2, (unsigned short)digP3, (unsigned short)digP4, (unsigned short)digP5,
+		(unsigned short)digP6, (unsigned short)digP7, (unsigned short)digP8, (unsigned short)digP9 };
+	for (unsigned int i = 0; i < 12; i++) {
+		registers.setValue((unsigned char)(registerCalibration0 + 2 * i), (unsigned char)(words[i] & 0xff));
+		registers.setValue((unsigned char)(registerCalibration0 + 2 * i + 1), (unsigned char)(words[i] >> 8));
+	}
+	registers.setValue(registerHumidity1, digH1);
+	registers.setValue(registerCalibration1, (unsigned char)(digH2 & 0xff));
+	registers.setValue(registerCalibration1 + 1, (unsigned char)((unsigned short)digH2 >> 8));
+	registers.setValue(registerCalibration1 + 2, digH3);
+	registers.setValue(registerCalibration1 + 3, (unsigned char)(digH4 >> 4));
+	registers.setValue(registerCalibration1 + 4, (unsigned char)((digH4 & 0x0f) | ((digH5 & 0x0f) << 4)));
+	registers.setValue(registerCalibration1 + 5, (unsigned char)(digH5 >> 4));
+	registers.setValue(registerCalibration1 + 6, (unsigned char)digH6);
+}
+
+unsigned long long Bme280Model::measurementMicros()
+{
+	// maximal measurement time of the data sheet
+	unsigned char control = registers.value(registerControlMeasurement);
+	unsigned int temperature = samples(control >> 5);
+	unsigned int pressure = samples((control >> 2) & 0x07);
+	unsigned int humidity = samples(registers.value(registerControlHumidity) & 0x07);
+	unsigned long long micros = 1250 + 2300ULL * temperature;
+	if (pressure > 0) {
+		micros += 2300ULL * pressure + 575;
+	}
+	if (humidity > 0) {
+		micros += 2300ULL * humidity + 575;
+	}
+	return micros;
+}
+
+void Bme280Model::startMeasurement(unsigned long long start)
+{
+	_measuring = true;
+	_measurementStart = start;
+	_measurementEnd = start + measurementMicros();
+	registers.setValue(registerStatus, constStatusMeasuring);
+}
+
+void Bme280Model::update()
+{
+	if (!_measuring) {
+		return;
+	}
+
+	unsigned long long now = micros();
+	if (now < _measurementEnd) {
+		registers.setValue(registerStatus, now >= _measurementStart ? constStatusMeasuring : 0x00);
+		return;
+	}
+	latchMeasurement();
+
+	unsigned char control = registers.value(registerControlMeasurement);
+	if ((control & 0x03) != constModeNormal) {
+		// a forced measurement returns to sleep mode
+		_measuring = false;
+		registers.setValue(registerStatus, 0x00);
+		registers.setValue(registerControlMeasurement, (unsigned char)(control & ~0x03));
+		return;
+	}
+
+	// normal mode cycles, the measurements nobody read are skipped
+	unsigned long long period = measurementMicros() + constStandbyMicros[registers.value(registerConfig) >> 5];
+	unsigned long long start = _measurementStart + period * ((now - _measurementStart) / period);
+	if (now >= start + measurementMicros()) {
+		// in standby, the next measurement starts with the next cycle
+		start += period;
+	}
+	startMeasurement(start);
+	registers.setValue(registerStatus, now >= _measurementStart ? constStatusMeasuring : 0x00);
+}
+
+void Bme280Model::writeRegister(unsigned int address, unsigned char value)
+{
+	if (address == registerReset) {
+		if (value == constResetCommand) {
+			reset();
+		}
+		return;
+	}
+
+	TwiRegisterDevice::writeRegister(address, value);
+	if (address == registerControlMeasurement) {
+		if ((value & 0x03) == constModeSleep) {
+			_measuring = false;
+			registers.setValue(registerStatus, 0x00);
+		} else {
+			startMeasurement(micros());
+		}
+	}
+}
+
+void Bme280Model::latchMeasurement()
+{
+	unsigned char control = registers.value(registerControlMeasurement);
+	int tFine = 0;
+
+	int adcT = 0x80000;
+	if ((control >> 5) != 0) {
+		// the compensated temperature rises with the raw value
+		int target = (int)(_celsius * 100.0 + (_celsius < 0 ? -0.5 : 0.5));
+		int low = 0;
+		int high = 0xfffff;
+		while (low < high) {
+			int middle = (low + high) / 2;
+			if (compensateTemperature(middle, &tFine) < target) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		adcT = low;
+	}
+	compensateTemperature(adcT, &tFine);
+
+	int adcP = 0x80000;
+	if (((control >> 2) & 0x07) != 0) {
+		// the compensated pressure falls with the raw value
+		unsigned int target = (unsigned int)(_pascal * 256.0 + 0.5);
+		int low = 0;
+		int high = 0xfffff;
+		while (low < high) {
+			int middle = (low + high) / 2;
+			if (compensatePressure(middle, tFine) > target) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		adcP = low;
+	}
+
+	int adcH = 0x8000;
+	if ((registers.value(registerControlHumidity) & 0x07) != 0) {
+		unsigned int target = (unsigned int)(_relativeHumidity * 1024.0 + 0.5);
+		int low = 0;
+		int high = 0xffff;
+		while (low < high) {
+			int middle = (low + high) / 2;
+			if (compensateHumidity(middle, tFine) < target) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		adcH = low;
+	}
+
+	registers.setValue(registerPressure, (unsigned char)(adcP >> 12));
+	registers.setValue(registerPressure + 1, (unsigned char)(adcP >> 4));
+	registers.setValue(registerPressure + 2, (unsigned char)((adcP & 0x0f) << 4));
+	registers.setValue(registerTemperature, (unsigned char)(adcT >> 12));
+	registers.setValue(registerTemperature + 1, (unsigned char)(adcT >> 4));
+	registers.setValue(registerTemperature + 2, (unsigned char)((adcT & 0x0f) << 4));
+	registers.setValue(registerHumidity, (unsigned char)(adcH >> 8));
+	registers.setValue(registerHumidity + 1, (unsigned char)(adcH & 0xff));
+}
@@ -0,0 +1,64 @@
+/*
+  Bme280Model.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "TwiRegisterDevice.h"
+
+// Model of a BME280 humidity, pressure and temperature sensor. It has the registers,
+// calibration data, forced and normal mode, oversampling dependent measurement time and
+// the measuring status bit of the chip. The raw values are chosen so the compensation
+// formulas of the data sheet give back the environment set with setEnvironment().
+// The IIR filter is not modeled.
+class __declspec(dllexport) Bme280Model : public TwiRegisterDevice
+{
+private: double _celsius;
+private: double _pascal;
+private: double _relativeHumidity;
+private: bool _measuring;
+private: unsigned long long _measurementStart;
+private: unsigned long long _measurementEnd;
+
+public: Bme280Model();
+
+	// Takes effect with the next measurement, default 20 degree Celsius, 101325 Pa, 50 %RH
+public: void setEnvironment(double celsius, double pascal, double relativeHumidity);
+
+protected: virtual void update();
+
+protected: virtual void writeRegister(unsigned int address, unsigned char value);
+
+private: void reset();
+
+private: unsigned long long measurementMicros();
+
+private: void startMeasurement(unsigned long long start);
+
+	// Latches the raw values of a finished measurement into the data registers
+private: void latchMeasurement();
+};
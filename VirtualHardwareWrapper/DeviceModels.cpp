@@ -0,0 +1,258 @@
+/*
+  DeviceModels.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "DeviceModels.h"
+#include "Bme280Model.h"
+#include "EepromModel.h"
+#include "Mcp4822Model.h"
+#include "Pca9555Model.h"
+#include "TwiLocalBus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	const unsigned int constMaxModels = 16;
+
+	struct EepromType
+	{
+		const char* name;
+		unsigned int size;
+		unsigned int pageSize;
+	};
+
+	const EepromType constEepromTypes[] =
+	{
+		{ "24LC01", 128, 8 },
+		{ "24LC02", 256, 8 },
+		{ "24LC32", 4096, 32 },
+		{ "24LC64", 8192, 32 },
+		{ "24LC128", 16384, 64 },
+		{ "24LC256", 32768, 64 },
+		{ "24LC512", 65536, 128 }
+	};
+
+	struct TwiModel
+	{
+		TwiDevice* device;
+		TwiLocalBus* bus;
+		unsigned char address;
+	};
+
+	struct SpiModel
+	{
+		SpiDevice* device;
+		unsigned char chipSelectPin;
+		bool selected;
+	};
+
+	// Calls found(name, number) for every "<name>@<number>" of the comma separated list
+	template<typename Found>
+	void parseModels(const char* list, Found found)
+	{
+		if (list == NULL) {
+			return;
+		}
+		char entry[64];
+		while (*list != '\0') {
+			size_t length = strcspn(list, ",");
+			if (length > 0 && length < sizeof(entry)) {
+				memcpy(entry, list, length);
+				entry[length] = '\0';
+				char* at = strchr(entry, '@');
+				if (at != NULL) {
+					*at = '\0';
+					found(entry, (unsigned int)strtoul(at + 1, NULL, 0));
+				} else {
+					fprintf(stderr, "DeviceModels: missing @ in '%s'\n", entry);
+				}
+			}
+			list += length;
+			if (*list == ',') {
+				list++;
+			}
+		}
+	}
+}
+
+class DeviceModelsPrivate
+{
+	public: TwiModel twiModels[constMaxModels];
+	public: unsigned int twiCount;
+	public: SpiModel spiModels[constMaxModels];
+	public: unsigned int spiCount;
+
+	public: DeviceModelsPrivate()
+		: twiCount(0), spiCount(0)
+	{
+	}
+};
+
+DeviceModels::DeviceModels()
+{
+	_private = new DeviceModelsPrivate();
+	DeviceModelsPrivate* models = _private;
+
+	parseModels(getenv("VM_TWI_MODELS"), [models](const char* name, unsigned int address) {
+		TwiDevice* device = createTwiModel(name);
+		if (device == NULL || models->twiCount == constMaxModels) {
+			fprintf(stderr, "DeviceModels: cannot add TWI model %s\n", name);
+			delete device;
+			return;
+		}
+		TwiLocalBus* bus = new TwiLocalBus();
+		if (!bus->begin((unsigned char)address, device)) {
+			fprintf(stderr, "DeviceModels: TWI address 0x%02x in use\n", address);
+			delete bus;
+			delete device;
+			return;
+		}
+		TwiModel& model = models->twiModels[models->twiCount++];
+		model.device = device;
+		model.bus = bus;
+		model.address = (unsigned char)address;
+	});
+
+	parseModels(getenv("VM_SPI_MODELS"), [models](const char* name, unsigned int pin) {
+		SpiDevice* device = createSpiModel(name);
+		if (device == NULL || models->spiCount == constMaxModels) {
+			fprintf(stderr, "DeviceModels: cannot add SPI model %s\n", name);
+			delete device;
+			return;
+		}
+		SpiModel& model = models->spiModels[models->spiCount++];
+		model.device = device;
+		model.chipSelectPin = (unsigned char)pin;
+		model.selected = false;
+	});
+	if (_private->spiCount == 1) {
+		_private->spiModels[0].selected = true;
+	}
+}
+
+DeviceModels::~DeviceModels()
+{
+	for (unsigned int i = 0; i < _private->twiCount; i++) {
+		delete _private->twiModels[i].bus;
+		delete _private->twiModels[i].device;
+	}
+	for (unsigned int i = 0; i < _private->spiCount; i++) {
+		delete _private->spiModels[i].device;
+	}
+	delete _private;
+}
+
+DeviceModels& DeviceModels::instance()
+{
+	// the models stay for boards which use them after the static objects are gone
+	static DeviceModels* deviceModels = new DeviceModels();
+	return *deviceModels;
+}
+
+bool DeviceModels::twiEnabled()
+{
+	return _private->twiCount > 0;
+}
+
+bool DeviceModels::spiEnabled()
+{
+	return _private->spiCount > 0;
+}
+
+TwiDevice* DeviceModels::twiModel(unsigned char address)
+{
+	for (unsigned int i = 0; i < _private->twiCount; i++) {
+		if (_private->twiModels[i].address == address) {
+			return _private->twiModels[i].device;
+		}
+	}
+	return NULL;
+}
+
+SpiDevice* DeviceModels::spiModel(unsigned char chipSelectPin)
+{
+	for (unsigned int i = 0; i < _private->spiCount; i++) {
+		if (_private->spiModels[i].chipSelectPin == chipSelectPin) {
+			return _private->spiModels[i].device;
+		}
+	}
+	return NULL;
+}
+
+void DeviceModels::chipSelect(unsigned char pin, bool high)
+{
+	for (unsigned int i = 0; i < _private->spiCount; i++) {
+		SpiModel& model = _private->spiModels[i];
+		if (model.chipSelectPin != pin || model.selected == !high) {
+			continue;
+		}
+		model.selected = !high;
+		if (model.selected) {
+			model.device->select();
+		} else {
+			model.device->deselect();
+		}
+	}
+}
+
+void DeviceModels::spiTransfer(const unsigned char* txBuffer, unsigned char* rxBuffer, unsigned int size)
+{
+	// nobody drives MISO
+	memset(rxBuffer, 0xff, size);
+	for (unsigned int i = 0; i < _private->spiCount; i++) {
+		if (_private->spiModels[i].selected) {
+			_private->spiModels[i].device->transfer(txBuffer, rxBuffer, size);
+		}
+	}
+}
+
+TwiDevice* DeviceModels::createTwiModel(const char* name)
+{
+	if (strcmp(name, "PCA9555") == 0) {
+		return new Pca9555Model();
+	}
+	if (strcmp(name, "BME280") == 0) {
+		return new Bme280Model();
+	}
+	for (unsigned int i = 0; i < sizeof(constEepromTypes) / sizeof(constEepromTypes[0]); i++) {
+		if (strcmp(name, constEepromTypes[i].name) == 0) {
+			return new EepromModel(constEepromTypes[i].size, constEepromTypes[i].pageSize);
+		}
+	}
+	return NULL;
+}
+
+SpiDevice* DeviceModels::createSpiModel(const char* name)
+{
+	if (strcmp(name, "MCP4822") == 0) {
+		return new Mcp4822Model();
+	}
+	return NULL;
+}
@@ -0,0 +1,79 @@
+/*
+  DeviceModels.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "SpiDevice.h"
+#include "TwiDevice.h"
+
+// Built-in models of I2C and SPI chips for running sketches without hardware, e.g.
+//
+//   VM_TWI_MODELS=PCA9555@0x20,24LC256@0x50,BME280@0x76
+//   VM_SPI_MODELS=MCP4822@13
+//
+// with the chip select pin of the SPI models. If set, TwiWrapper and SpiWrapper talk to
+// the models instead of an IO-Warrior. The TWI models are slaves on the TwiLocalBus of
+// the process, so VirtualTwiWrapper with VM_TWI_TRANSPORT=local reaches them as well.
+// Known chips: PCA9555, 24LC01, 24LC02, 24LC32, 24LC64, 24LC128, 24LC256, 24LC512, BME280
+// and MCP4822. The 24LC04, 24LC08 and 24LC16 select their 256 byte blocks with address bits
+// and are not modelled.
+
+class DeviceModelsPrivate;
+
+class __declspec(dllexport) DeviceModels
+{
+private: DeviceModelsPrivate* _private;
+
+private: DeviceModels();
+
+public: ~DeviceModels();
+
+	// The models of this process, created from the environment on the first call
+public: static DeviceModels& instance();
+
+public: bool twiEnabled();
+
+public: bool spiEnabled();
+
+	// The model at the address, e.g. for a test bench to set inputs, NULL if none
+public: TwiDevice* twiModel(unsigned char address);
+
+	// The model at the chip select pin, NULL if none
+public: SpiDevice* spiModel(unsigned char chipSelectPin);
+
+	// The sketch wrote the pin, selects or deselects the SPI model at it
+public: void chipSelect(unsigned char pin, bool high);
+
+	// Transfer with the selected SPI models, a single model is always selected
+public: void spiTransfer(const unsigned char* txBuffer, unsigned char* rxBuffer, unsigned int size);
+
+	// A new model of the chip, NULL for unknown names
+public: static TwiDevice* createTwiModel(const char* name);
+
+public: static SpiDevice* createSpiModel(const char* name);
+};
@@ -0,0 +1,86 @@
+/*
+  EepromModel.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "EepromModel.h"
+
+#include <string.h>
+
+namespace
+{
+	const unsigned long long constWriteCycleMicros = 5000;
+}
+
+EepromModel::EepromModel(unsigned int size, unsigned int pageSize)
+	: TwiRegisterDevice(NULL, 0, size > 256 ? 2 : 1), _size(size), _pageSize(pageSize), _busyUntil(0)
+{
+	_memory = new unsigned char[size];
+	memset(_memory, 0xff, size);
+}
+
+EepromModel::~EepromModel()
+{
+	delete[] _memory;
+}
+
+unsigned char* EepromModel::memory()
+{
+	return _memory;
+}
+
+unsigned int EepromModel::size()
+{
+	return _size;
+}
+
+bool EepromModel::acknowledge()
+{
+	return _busyUntil == 0 || micros() >= _busyUntil;
+}
+
+unsigned char EepromModel::readRegister(unsigned int address)
+{
+	return _memory[address & (_size - 1)];
+}
+
+void EepromModel::writeRegister(unsigned int address, unsigned char value)
+{
+	_memory[address & (_size - 1)] = value;
+}
+
+unsigned int EepromModel::nextRegister(unsigned int address, bool writing)
+{
+	if (writing) {
+		return (address & ~(_pageSize - 1)) | ((address + 1) & (_pageSize - 1));
+	}
+	return (address + 1) & (_size - 1);
+}
+
+void EepromModel::writeEnded(unsigned int /*count*/)
+{
+	_busyUntil = micros() + constWriteCycleMicros;
+}
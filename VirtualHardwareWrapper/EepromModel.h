@@ -0,0 +1,65 @@
+/*
+  EepromModel.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "TwiRegisterDevice.h"
+
+// Model of a 24LCxx I2C EEPROM, e.g. 24LC02 (256 bytes, 8 byte pages, one address byte)
+// or 24LC256 (32 KiB, 64 byte pages, two address bytes). Writes wrap within the page.
+// The chip does not acknowledge its address during the 5 ms write cycle after a write,
+// so acknowledge polling works like on the real chip.
+// Sizes above 256 bytes take two address bytes, so chips which select 256 byte blocks
+// with their I2C address bits (24LC04, 24LC08, 24LC16) do not fit this model.
+class __declspec(dllexport) EepromModel : public TwiRegisterDevice
+{
+private: unsigned char* _memory;
+private: unsigned int _size;
+private: unsigned int _pageSize;
+private: unsigned long long _busyUntil;
+
+	// size and pageSize must be powers of two
+public: EepromModel(unsigned int size, unsigned int pageSize);
+
+public: virtual ~EepromModel();
+
+	// The content, erased to 0xff at start
+public: unsigned char* memory();
+
+public: unsigned int size();
+
+public: virtual bool acknowledge();
+
+protected: virtual unsigned char readRegister(unsigned int address);
+
+protected: virtual void writeRegister(unsigned int address, unsigned char value);
+
+protected: virtual unsigned int nextRegister(unsigned int address, bool writing);
+
+protected: virtual void writeEnded(unsigned int count);
+};
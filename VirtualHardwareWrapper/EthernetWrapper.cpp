@@ -27,15 +27,154 @@
 */
 
 #include <msclr\auto_gcroot.h>
+#include <msclr\marshal_cppstd.h>
+#include <vcclr.h>
+#include <map>
+#include <string>
+#include <string.h>
 #include "EthernetWrapper.h"
 
 using namespace System::Runtime::InteropServices; // Marshal
 using namespace VirtualHardwareNet;
 
 
+// Last string returned for a socket, converted again only when the managed value changes
+struct InternedString
+{
+	gcroot<System::String^> value;
+	std::string ansi;
+};
+
+typedef std::map<int, InternedString> InternedStrings;
+
+// Bytes read ahead from the managed receive queue of a socket, so that read(), peek()
+// and available() of the sketch are served without crossing into the CLR
+struct ReadCache
+{
+	static const unsigned int size = 1024;
+
+	unsigned char data[size];
+	unsigned int head;
+	unsigned int tail;
+	// available() refills a non empty cache only if nothing was read since its last call,
+	// so a sketch polling for more bytes than cached still sees them arrive
+	bool consumed;
+
+	ReadCache() : head(0), tail(0), consumed(true) {}
+
+	unsigned int count() const
+	{
+		return tail - head;
+	}
+
+	void clear()
+	{
+		head = tail = 0;
+		consumed = true;
+	}
+
+	// move the cached bytes to the front, returns the free space behind them
+	unsigned int compact()
+	{
+		if (head > 0) {
+			memmove(data, data + head, count());
+			tail -= head;
+			head = 0;
+		}
+		return size - tail;
+	}
+
+	unsigned int take(unsigned char *buf, unsigned int bytes)
+	{
+		unsigned int length = count() < bytes ? count() : bytes;
+		memcpy(buf, data + head, length);
+		head += length;
+		consumed = true;
+		return length;
+	}
+};
+
+typedef std::map<int, ReadCache> ReadCaches;
+
+// The packet of the last udpParsePacket(), read in place from the receive ring of its socket
+struct UdpPacket
+{
+	const unsigned char *data;
+	unsigned int length;
+	unsigned int position;
+
+	UdpPacket() : data(nullptr), length(0), position(0) {}
+
+	unsigned int count() const
+	{
+		return length - position;
+	}
+};
+
+typedef std::map<int, UdpPacket> UdpPackets;
+
+// The datagram between udpBeginPacket() and udpEndPacket(), written in place into the
+// pinned send buffer of its socket
+struct UdpDatagram
+{
+	unsigned char *data;
+	unsigned int capacity;
+	unsigned int length;
+	// destination of the last packet, given as dotted IPv4 address
+	std::string hostname;
+	unsigned int port;
+
+	UdpDatagram() : data(nullptr), capacity(0), length(0), port(0) {}
+};
+
+typedef std::map<int, UdpDatagram> UdpDatagrams;
+
 class EthernetWrapperPrivate
 {
 	public: msclr::auto_gcroot<EthernetNet^> ethernet;
+
+	public: InternedStrings clientErrorMessages;
+	public: InternedStrings clientSocketErrorCodes;
+	public: InternedStrings clientRemoteIpAddresses;
+	public: InternedStrings serverErrorMessages;
+	public: InternedStrings serverSocketErrorCodes;
+
+	public: ReadCaches clientCaches;
+	public: UdpPackets udpPackets;
+	public: UdpDatagrams udpDatagrams;
+
+	public: void fillClient(int socketNumber, ReadCache &cache)
+	{
+		unsigned int free = cache.compact();
+		if (free > 0) {
+			int count = ethernet->clientRead(socketNumber, cache.data + cache.tail, free);
+			if (count > 0) {
+				cache.tail += count;
+			}
+		}
+	}
+
+	public: void clearCache(ReadCaches &caches, int socketNumber)
+	{
+		ReadCaches::iterator it = caches.find(socketNumber);
+		if (it != caches.end()) {
+			it->second.clear();
+		}
+	}
+
+	public: const char* intern(InternedStrings &strings, int socketNumber, System::String^ value)
+	{
+		if (value == nullptr) {
+			return nullptr;
+		}
+
+		InternedString &interned = strings[socketNumber];
+		if (!System::String::Equals((System::String^)interned.value, value)) {
+			interned.value = value;
+			interned.ansi = msclr::interop::marshal_as<std::string>(value);
+		}
+		return interned.ansi.c_str();
+	}
 };
 
 EthernetWrapper::EthernetWrapper()
@@ -49,6 +188,11 @@ EthernetWrapper::~EthernetWrapper()
 	delete _private;
 }
 
+int EthernetWrapper::init(int maxClients, int maxServers, int maxUdpClients)
+{
+	return _private->ethernet->init(maxClients, maxServers, maxUdpClients);
+}
+
 unsigned int EthernetWrapper::localIpAddress()
 {
 	return _private->ethernet->localIpAddress();
@@ -59,6 +203,21 @@ unsigned int EthernetWrapper::dnsServerAddress()
 	return _private->ethernet->dnsServerAddress();
 }
 
+unsigned long EthernetWrapper::dnsCacheHits()
+{
+	return (unsigned long)_private->ethernet->dnsCacheHits();
+}
+
+unsigned long EthernetWrapper::dnsCacheMisses()
+{
+	return (unsigned long)_private->ethernet->dnsCacheMisses();
+}
+
+void EthernetWrapper::dnsSetCacheTtl(unsigned int positiveMillis, unsigned int negativeMillis)
+{
+	_private->ethernet->dnsSetCacheTtl(positiveMillis, negativeMillis);
+}
+
 unsigned int EthernetWrapper::gatewayAddress()
 {
 	return _private->ethernet->gatewayAddress();
@@ -78,13 +237,13 @@ unsigned int EthernetWrapper::subnetMask()
 const char* EthernetWrapper::clientErrorMessage(int socketNumber)
 {
 	System::String^ errorMessage = _private->ethernet->clientErrorMessage(socketNumber);
-	return (const char*)Marshal::StringToHGlobalAnsi(errorMessage).ToPointer();
+	return _private->intern(_private->clientErrorMessages, socketNumber, errorMessage);
 }
 
 const char* EthernetWrapper::clientSocketErrorCode(int socketNumber)
 {
 	System::String^ socketErrorCode = _private->ethernet->clientSocketErrorCode(socketNumber);
-	return (const char*)Marshal::StringToHGlobalAnsi(socketErrorCode).ToPointer();
+	return _private->intern(_private->clientSocketErrorCodes, socketNumber, socketErrorCode);
 }
 
 long EthernetWrapper::clientErrorCode(int socketNumber)
@@ -97,22 +256,58 @@ int EthernetWrapper::clientConnect(const char *hostname, unsigned int port, int
 	int sock;
 	int result = _private->ethernet->clientConnect(gcnew System::String(hostname), port, sock);
 	*socketNumber = sock;
+	_private->clearCache(_private->clientCaches, sock);
 	return result;
 }
 
+void EthernetWrapper::clientSetConnectionTimeout(unsigned int milliseconds)
+{
+	_private->ethernet->clientSetConnectionTimeout(milliseconds);
+}
+
+void EthernetWrapper::clientSetAsyncConnect(bool enabled)
+{
+	_private->ethernet->clientSetAsyncConnect(enabled);
+}
+
 int EthernetWrapper::clientAvailable(int socketNumber)
 {
-	return _private->ethernet->clientAvailable(socketNumber);
+	if (socketNumber < 0) {
+		return 0;
+	}
+
+	ReadCache &cache = _private->clientCaches[socketNumber];
+	if (cache.count() == 0 || !cache.consumed) {
+		_private->fillClient(socketNumber, cache);
+	}
+	cache.consumed = false;
+	return cache.count();
 }
 
 unsigned char EthernetWrapper::clientConnected(int socketNumber)
 {
+	// like the managed side, a closed connection with unread data counts as connected
+	ReadCaches::iterator it = _private->clientCaches.find(socketNumber);
+	if (it != _private->clientCaches.end() && it->second.count() > 0) {
+		return 1;
+	}
 	return _private->ethernet->clientConnected(socketNumber);
 }
 
 int EthernetWrapper::clientPeek(int socketNumber)
 {
-	return _private->ethernet->clientPeek(socketNumber);
+	if (socketNumber < 0) {
+		return -1;
+	}
+
+	ReadCache &cache = _private->clientCaches[socketNumber];
+	if (cache.count() == 0) {
+		_private->fillClient(socketNumber, cache);
+		if (cache.count() == 0) {
+			return -1;
+		}
+	}
+	return cache.data[cache.head];
 }
 
 void EthernetWrapper::clientFlush(int socketNumber)
@@ -123,6 +318,7 @@ void EthernetWrapper::clientFlush(int socketNumber)
 void EthernetWrapper::clientStop(int socketNumber)
 {
 	_private->ethernet->clientStop(socketNumber);
+	_private->clearCache(_private->clientCaches, socketNumber);
 }
 
 unsigned char EthernetWrapper::clientStatus(int socketNumber)
@@ -133,6 +329,7 @@ unsigned char EthernetWrapper::clientStatus(int socketNumber)
 void EthernetWrapper::clientClose(int socketNumber)
 {
 	_private->ethernet->clientClose(socketNumber);
+	_private->clearCache(_private->clientCaches, socketNumber);
 }
 
 unsigned int EthernetWrapper::clientWrite(int socketNumber, const unsigned char *buf, unsigned int size)
@@ -144,18 +341,36 @@ unsigned int EthernetWrapper::clientWrite(int socketNumber, const unsigned char
 
 int EthernetWrapper::clientRead(int socketNumber, unsigned char *buf, unsigned int bytes)
 {
-	array<unsigned char>^ data = gcnew array<unsigned char>(bytes);
-	int result = _private->ethernet->clientRead(socketNumber, data, bytes);
-	if (result > 0) {
-		Marshal::Copy(data, 0, System::IntPtr((void *)buf), result);
+	if (socketNumber < 0 || bytes == 0) {
+		return -1;
 	}
-	return result;
+
+	ReadCache &cache = _private->clientCaches[socketNumber];
+	unsigned int length = cache.take(buf, bytes);
+	if (length < bytes) {
+		if (bytes - length >= ReadCache::size) {
+			// large reads go straight into the caller's memory
+			int count = _private->ethernet->clientRead(socketNumber, buf + length, bytes - length);
+			if (count > 0) {
+				length += count;
+			}
+		} else if (length == 0) {
+			_private->fillClient(socketNumber, cache);
+			length = cache.take(buf, bytes);
+		}
+	}
+	return length > 0 ? (int)length : -1;
 }
 
 const char* EthernetWrapper::clientRemoteIpAddress(int socketNumber)
 {
 	System::String^ remoteIpAddress = _private->ethernet->clientRemoteIpAddress(socketNumber);
-	return (const char*)Marshal::StringToHGlobalAnsi(remoteIpAddress).ToPointer();
+	return _private->intern(_private->clientRemoteIpAddresses, socketNumber, remoteIpAddress);
+}
+
+unsigned int EthernetWrapper::clientRemoteIp(int socketNumber)
+{
+	return _private->ethernet->clientRemoteIp(socketNumber);
 }
 
 unsigned int EthernetWrapper::clientRemotePort(int socketNumber)
@@ -168,13 +383,13 @@ unsigned int EthernetWrapper::clientRemotePort(int socketNumber)
 const char* EthernetWrapper::serverErrorMessage(int socketNumber)
 {
 	System::String^ errorMessage = _private->ethernet->serverErrorMessage(socketNumber);
-	return (const char*)Marshal::StringToHGlobalAnsi(errorMessage).ToPointer();
+	return _private->intern(_private->serverErrorMessages, socketNumber, errorMessage);
 }
 
 const char* EthernetWrapper::serverSocketErrorCode(int socketNumber)
 {
 	System::String^ socketErrorCode = _private->ethernet->serverSocketErrorCode(socketNumber);
-	return (const char*)Marshal::StringToHGlobalAnsi(socketErrorCode).ToPointer();
+	return _private->intern(_private->serverSocketErrorCodes, socketNumber, socketErrorCode);
 }
 
 long EthernetWrapper::serverErrorCode(int socketNumber)
@@ -192,7 +407,24 @@ int EthernetWrapper::serverBegin(const char *ipAddress, unsigned int port, int *
 
 int EthernetWrapper::serverAccept(int socketNumber)
 {
-	return _private->ethernet->serverAccept(socketNumber);
+	int result = _private->ethernet->serverAccept(socketNumber);
+	_private->clearCache(_private->clientCaches, result);
+	return result;
+}
+
+void EthernetWrapper::serverSetBacklog(int backlog)
+{
+	_private->ethernet->serverSetBacklog(backlog);
+}
+
+unsigned long EthernetWrapper::serverAcceptedClients(int socketNumber)
+{
+	return (unsigned long)_private->ethernet->serverAcceptedClients(socketNumber);
+}
+
+unsigned long EthernetWrapper::serverRejectedClients(int socketNumber)
+{
+	return (unsigned long)_private->ethernet->serverRejectedClients(socketNumber);
 }
 
 // ---------------------------------------------------------
@@ -202,6 +434,8 @@ int EthernetWrapper::udpBegin(unsigned int port, int *socketNumber)
 	int sock;
 	int result = _private->ethernet->udpBegin(port, sock);
 	*socketNumber = sock;
+	_private->udpPackets.erase(sock);
+	_private->udpDatagrams.erase(sock);
 	return result;
 }
 
@@ -210,54 +444,133 @@ int EthernetWrapper::udpBeginMulticast(unsigned int ipAddress, unsigned int port
 	int sock;
 	int result = _private->ethernet->udpBeginMulticast(ipAddress, port, sock);
 	*socketNumber = sock;
+	_private->udpPackets.erase(sock);
+	_private->udpDatagrams.erase(sock);
 	return result;
 }
 
+unsigned int EthernetWrapper::udpSetTxBufferSize(int socketNumber, unsigned int size)
+{
+	// the send buffer is reallocated
+	_private->udpDatagrams.erase(socketNumber);
+	return _private->ethernet->udpSetTxBufferSize(socketNumber, size);
+}
+
 int EthernetWrapper::udpBeginPacket(int socketNumber, const char *hostname, unsigned int port)
 {
-	int result = _private->ethernet->udpBeginPacket(socketNumber, gcnew System::String(hostname), port);
+	if (socketNumber < 0 || hostname == nullptr) {
+		return 0;
+	}
+
+	UdpDatagram &datagram = _private->udpDatagrams[socketNumber];
+	// the same dotted address again needs no resolving, the managed side still has it
+	if (datagram.capacity > 0 && datagram.port == port && datagram.hostname == hostname
+		&& strspn(hostname, "0123456789.") == strlen(hostname)) {
+		datagram.length = 0;
+		return 1;
+	}
+
+	System::IntPtr data;
+	int capacity;
+	int result = _private->ethernet->udpBeginPacket(socketNumber, gcnew System::String(hostname), port, data, capacity);
+	if (result != 1) {
+		_private->udpDatagrams.erase(socketNumber);
+		return result;
+	}
+	datagram.data = (unsigned char *)data.ToPointer();
+	datagram.capacity = capacity;
+	datagram.length = 0;
+	datagram.hostname = hostname;
+	datagram.port = port;
 	return result;
 }
 
 int EthernetWrapper::udpEndPacket(int socketNumber)
 {
-	return _private->ethernet->udpEndPacket(socketNumber);
+	UdpDatagrams::iterator it = _private->udpDatagrams.find(socketNumber);
+	if (it == _private->udpDatagrams.end()) {
+		return _private->ethernet->udpEndPacket(socketNumber);
+	}
+	int length = it->second.length;
+	it->second.length = 0;
+	return _private->ethernet->udpEndPacket(socketNumber, length);
+}
+
+void EthernetWrapper::udpSetBatchMode(int socketNumber, bool enabled)
+{
+	_private->ethernet->udpSetBatchMode(socketNumber, enabled);
 }
 
 int EthernetWrapper::udpParsePacket(int socketNumber, unsigned int *remoteIpAddress, unsigned int *remotePort)
 {
 	unsigned short port;
 	unsigned int ipAddress; 
-	int result = _private->ethernet->udpParsePacket(socketNumber, ipAddress, port);
+	System::IntPtr data;
+	int result = _private->ethernet->udpParsePacket(socketNumber, ipAddress, port, data);
 	*remoteIpAddress = ipAddress;
 	*remotePort = port;
+	if (socketNumber >= 0) {
+		// the rest of the previous packet is gone
+		UdpPacket &packet = _private->udpPackets[socketNumber];
+		packet.data = (const unsigned char *)data.ToPointer();
+		packet.length = result > 0 ? result : 0;
+		packet.position = 0;
+	}
 	return result;
 }
 
 unsigned int EthernetWrapper::udpWrite(int socketNumber, const unsigned char *buf, unsigned int size)
 {
-	array<unsigned char>^ data = gcnew array<unsigned char>(size);
-	Marshal::Copy(System::IntPtr((void *)buf), data, 0, size);
-	return _private->ethernet->udpWrite(socketNumber, data, size);
+	UdpDatagrams::iterator it = _private->udpDatagrams.find(socketNumber);
+	if (it == _private->udpDatagrams.end()) {
+		// no packet begun
+		return 0;
+	}
+	UdpDatagram &datagram = it->second;
+	unsigned int length = datagram.capacity - datagram.length < size ? datagram.capacity - datagram.length : size;
+	memcpy(datagram.data + datagram.length, buf, length);
+	datagram.length += length;
+	return length;
 }
 
 int EthernetWrapper::udpRead(int socketNumber, unsigned char *buf, unsigned int bytes)
 {
-	array<unsigned char>^ data = gcnew array<unsigned char>(bytes);
-	int result = _private->ethernet->udpRead(socketNumber, data, bytes);
-	if (result > 0) {
-		Marshal::Copy(data, 0, System::IntPtr((void *)buf), result);
+	if (socketNumber < 0 || bytes == 0) {
+		return -1;
 	}
-	return result;
+
+	UdpPacket &packet = _private->udpPackets[socketNumber];
+	unsigned int length = packet.count() < bytes ? packet.count() : bytes;
+	if (length == 0) {
+		return -1;
+	}
+	memcpy(buf, packet.data + packet.position, length);
+	packet.position += length;
+	return (int)length;
 }
 
 int EthernetWrapper::udpPeek(int socketNumber)
 {
-	return _private->ethernet->udpPeek(socketNumber);
+	if (socketNumber < 0) {
+		return -1;
+	}
+
+	UdpPacket &packet = _private->udpPackets[socketNumber];
+	if (packet.count() == 0) {
+		return -1;
+	}
+	return packet.data[packet.position];
 }
 
 void EthernetWrapper::udpClose(int socketNumber)
 {
 	_private->ethernet->udpClose(socketNumber);
+	_private->udpPackets.erase(socketNumber);
+	_private->udpDatagrams.erase(socketNumber);
+}
+
+unsigned long EthernetWrapper::udpDroppedPackets(int socketNumber)
+{
+	return (unsigned long)_private->ethernet->udpDroppedPackets(socketNumber);
 }
 
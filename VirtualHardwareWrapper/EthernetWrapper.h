@@ -38,18 +38,32 @@ public: EthernetWrapper();
 
 public: ~EthernetWrapper();
 
+public: int init(int maxClients, int maxServers, int maxUdpClients);
+
 //---------------------------------------------
 
 public: unsigned int localIpAddress();
 
 public: unsigned int dnsServerAddress();
 
+// Host name lookups of clientConnect() and udpBeginPacket() answered from the shared cache
+// and those which asked the resolver. Dotted IP addresses are not counted.
+public: unsigned long dnsCacheHits();
+
+public: unsigned long dnsCacheMisses();
+
+// Time resolved and unknown host names are cached, 0 does not cache them
+public: void dnsSetCacheTtl(unsigned int positiveMillis, unsigned int negativeMillis);
+
 public: unsigned int gatewayAddress();
 
 public: unsigned int subnetMask();
 
 //---------------------------------------------
 
+// The strings returned by the client and server accessors are owned by the wrapper.
+// They stay valid until the value of the same socket changes, do not free them.
+
 public: const char* clientErrorMessage(int socketNumber);
 
 public: const char* clientSocketErrorCode(int socketNumber);
@@ -58,6 +72,14 @@ public: long clientErrorCode(int socketNumber);
 
 public: int clientConnect(const char *hostname, unsigned int port, int *socketNumber);
 
+// Limits resolving and connecting in clientConnect(), like setConnectionTimeout() of the W5100.
+// 0 uses the timeout of the system.
+public: void clientSetConnectionTimeout(unsigned int milliseconds);
+
+// When enabled clientConnect() returns 1 at once, clientStatus() is SYNSENT (0x15) while connecting
+// and CLOSED after a failure or the connection timeout. The socket stays in use until clientStop().
+public: void clientSetAsyncConnect(bool enabled);
+
 public: int clientAvailable(int socketNumber);
 
 public: unsigned char clientConnected(int socketNumber);
@@ -78,6 +100,9 @@ public: int clientRead(int socketNumber, unsigned char *buf, unsigned int bytes)
 
 public: const char* clientRemoteIpAddress(int socketNumber);
 
+// remote IPv4 address packed like localIpAddress(), 0 if not connected
+public: unsigned int clientRemoteIp(int socketNumber);
+
 public: unsigned int clientRemotePort(int socketNumber);
 
 //---------------------------------------------
@@ -92,16 +117,31 @@ public: int serverBegin(const char *ipAddress, unsigned int port, int *socketNum
 
 public: int serverAccept(int socketNumber);
 
+// Connections the system queues for a server until they are accepted, used by the following
+// serverBegin() calls. 0 for the maximum of the system.
+public: void serverSetBacklog(int backlog);
+
+// Connections accepted and queued for serverAccept(), and those reset because all
+// client sockets were in use
+public: unsigned long serverAcceptedClients(int socketNumber);
+
+public: unsigned long serverRejectedClients(int socketNumber);
+
 // ---------------------------------------------
 
 public: int udpBegin(unsigned int port, int *socketNumber);
 
 public: int udpBeginMulticast(unsigned int ipAddress, unsigned int port, int* socketNumber);
 
+public: unsigned int udpSetTxBufferSize(int socketNumber, unsigned int size);
+
 public: int udpBeginPacket(int socketNumber, const char *hostname, unsigned int port);
 
 public: int udpEndPacket(int socketNumber);
 
+// Batch mode queues the packets of udpEndPacket() and sends them together from the reactor thread
+public: void udpSetBatchMode(int socketNumber, bool enabled);
+
 public: int udpParsePacket(int socketNumber, unsigned int *remoteIpAddress, unsigned int *remotePort);
 
 public: unsigned int udpWrite(int socketNumber, const unsigned char *buf, unsigned int size);
@@ -111,5 +151,8 @@ public: int udpRead(int socketNumber, unsigned char *buf, unsigned int bytes);
 public: int udpPeek(int socketNumber);
 
 public: void udpClose(int socketNumber);
+
+// Datagrams dropped because the receive ring of the socket was full
+public: unsigned long udpDroppedPackets(int socketNumber);
 		
 };
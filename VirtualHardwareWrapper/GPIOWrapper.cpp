@@ -28,19 +28,106 @@
 
 #include <msclr\auto_gcroot.h>
 #include "GPIOWrapper.h"
+#include "DeviceModels.h"
+#include "SimulatedGpio.h"
+
+#include <string.h>
 
 using namespace System::Runtime::InteropServices; // Marshal
 using namespace VirtualHardwareNet;
 
+namespace
+{
+  const unsigned char constMaxPins = 32;
+  const unsigned char constNoPin = 255;
+}
+
 class GPIOWrapperPrivate
 {
   public: msclr::auto_gcroot<GPIONet^> gpio;
+  // VM_SPI_MODELS: pins may be chip selects of SPI device models
+  public: bool spiModels;
+  // serial number "SIMULATED" or VM_GPIO=SIMULATED, NULL for an IO-Warrior
+  public: SimulatedGpio* simulated;
+  // IO-Warrior pin of the Arduino pins, copy of the pin table of GPIONet at begin()
+  public: unsigned char iowPins[constMaxPins];
+  // pins of the connected device by bit
+  public: unsigned long validPins;
+  // last level written to the pins, valid for the bits of outputsKnown
+  public: unsigned long outputs;
+  public: unsigned long outputsKnown;
+  // changed pins collected between beginTransaction() and commitTransaction()
+  public: bool transaction;
+  public: unsigned long pendingMask;
+
+  public: GPIOWrapperPrivate()
+    : spiModels(false), simulated(NULL), validPins(0), outputs(0), outputsKnown(0),
+      transaction(false), pendingMask(0)
+  {
+    memset(iowPins, constNoPin, sizeof(iowPins));
+  }
+
+  // Chip selects of SPI device models among the pins in mask
+  public: void chipSelects(unsigned long mask, unsigned long values)
+  {
+    for (unsigned char pin = 0; pin < constMaxPins && mask != 0; pin++, mask >>= 1) {
+      if ((mask & 1) != 0) {
+        DeviceModels::instance().chipSelect(pin, ((values >> pin) & 1) != 0);
+      }
+    }
+  }
+
+  // The pins in mask whose level differs from values or is unknown, marks them written
+  public: unsigned long changedPins(unsigned long mask, unsigned long values)
+  {
+    unsigned long changed = mask & ~(outputsKnown & ~(outputs ^ values));
+    outputs = (outputs & ~changed) | (values & changed);
+    outputsKnown |= changed;
+    return changed;
+  }
+
+  // Writes the changed pins of the IO-Warrior to their levels in outputs, or keeps them
+  // for commitTransaction()
+  public: void writePins(unsigned long changed)
+  {
+    if (transaction) {
+      pendingMask |= changed;
+      return;
+    }
+    for (unsigned char pin = 0; pin < constMaxPins && changed != 0; pin++, changed >>= 1) {
+      if ((changed & 1) != 0) {
+        gpio->DigitalWriteIow(iowPins[pin], (unsigned char)((outputs >> pin) & 1));
+      }
+    }
+  }
+
+  public: static bool portPins(unsigned char port, unsigned char* first, unsigned char* count)
+  {
+    // port numbers of the AVR core
+    switch (port) {
+    case 2:
+      *first = 8;
+      *count = 6;
+      return true;
+    case 3:
+      *first = 14;
+      *count = 6;
+      return true;
+    case 4:
+      *first = 0;
+      *count = 8;
+      return true;
+    default:
+      return false;
+    }
+  }
 };
 
 GPIOWrapper::GPIOWrapper()
 {
   _private = new GPIOWrapperPrivate();
   _private->gpio = gcnew GPIONet();
+  _private->spiModels = DeviceModels::instance().spiEnabled();
 }
 
 GPIOWrapper::~GPIOWrapper()
@@ -50,43 +137,210 @@ GPIOWrapper::~GPIOWrapper()
 
 void GPIOWrapper::begin(const char* serialNumber)
 {
+  _private->outputs = 0;
+  _private->outputsKnown = 0;
+  _private->transaction = false;
+  _private->pendingMask = 0;
+  if (SimulatedGpio::selected(serialNumber)) {
+    _private->simulated = &SimulatedGpio::instance();
+    _private->validPins = 0xffffffffUL;
+    return;
+  }
   _private->gpio->Begin(gcnew System::String(serialNumber));
+
+  array<unsigned char>^ table = _private->gpio->PinTable;
+  _private->validPins = 0;
+  for (int pin = 0; pin < constMaxPins; pin++) {
+    _private->iowPins[pin] = pin < table->Length ? table[pin] : constNoPin;
+    if (_private->iowPins[pin] != constNoPin) {
+      _private->validPins |= 1UL << pin;
+    }
+  }
 }
 
 void GPIOWrapper::end()
 {
+  _private->validPins = 0;
+  _private->outputsKnown = 0;
+  _private->transaction = false;
+  _private->pendingMask = 0;
+  if (_private->simulated != NULL) {
+    _private->simulated->stopInterrupts();
+    _private->simulated = NULL;
+    return;
+  }
   _private->gpio->End();
 }
 
 void GPIOWrapper::pinMode(unsigned char pin, unsigned char mode)
 {
-  _private->gpio->PinMode(pin, mode);
+  if (_private->simulated != NULL) {
+    _private->simulated->pinMode(pin, mode);
+    return;
+  }
+  if (pin >= constMaxPins || (_private->validPins & (1UL << pin)) == 0) {
+    return;
+  }
+  // the IO-Warrior writes a 1 for every mode
+  unsigned long bit = 1UL << pin;
+  _private->writePins(_private->changedPins(bit, bit));
 }
 
 unsigned char GPIOWrapper::digitalRead(unsigned char pin)
 {
-  unsigned char result = _private->gpio->DigitalRead(pin);
+  if (_private->simulated != NULL) {
+    return _private->simulated->digitalRead(pin);
+  }
+  if (pin >= constMaxPins || (_private->validPins & (1UL << pin)) == 0) {
+    return 0;
+  }
+  unsigned char result = _private->gpio->DigitalReadIow(_private->iowPins[pin]);
   return result;
 }
 
 void GPIOWrapper::digitalWrite(unsigned char pin, unsigned char value)
 {
-  _private->gpio->DigitalWrite(pin, value);
+  if (_private->spiModels) {
+    DeviceModels::instance().chipSelect(pin, value != 0);
+  }
+  if (pin >= constMaxPins) {
+    if (_private->simulated != NULL) {
+      _private->simulated->digitalWrite(pin, value);
+    }
+    return;
+  }
+  unsigned long bit = 1UL << pin;
+  unsigned long changed = _private->changedPins(bit & _private->validPins, value != 0 ? bit : 0);
+  if (changed == 0) {
+    return;
+  }
+  if (_private->simulated != NULL) {
+    _private->simulated->digitalWrite(pin, value);
+    return;
+  }
+  _private->writePins(changed);
 }
 
 void GPIOWrapper::digitalWritePort(unsigned char port, unsigned char value)
 {
-  _private->gpio->DigitalWritePort(port, value);
+  unsigned char first, count;
+  if (GPIOWrapperPrivate::portPins(port, &first, &count)) {
+    digitalWriteMask(((1UL << count) - 1) << first, (unsigned long)value << first);
+  }
+}
+
+unsigned char GPIOWrapper::digitalReadPort(unsigned char port)
+{
+  unsigned char first, count;
+  if (!GPIOWrapperPrivate::portPins(port, &first, &count)) {
+    return 0;
+  }
+  return (unsigned char)(digitalReadMask(((1UL << count) - 1) << first) >> first);
+}
+
+void GPIOWrapper::digitalWriteMask(unsigned long mask, unsigned long values)
+{
+  if (_private->spiModels) {
+    _private->chipSelects(mask, values);
+  }
+  unsigned long changed = _private->changedPins(mask & _private->validPins, values);
+  if (changed == 0) {
+    return;
+  }
+  if (_private->simulated != NULL) {
+    _private->simulated->digitalWriteMask(changed, values);
+    return;
+  }
+  _private->writePins(changed);
+}
+
+unsigned long GPIOWrapper::digitalReadMask(unsigned long mask)
+{
+  if (_private->simulated != NULL) {
+    return _private->simulated->digitalReadMask(mask);
+  }
+  mask &= _private->validPins;
+  if (mask == 0) {
+    return 0;
+  }
+  unsigned long result = 0;
+  for (unsigned char pin = 0; pin < constMaxPins; pin++) {
+    if ((mask & (1UL << pin)) != 0 && _private->gpio->DigitalReadIow(_private->iowPins[pin]) != 0) {
+      result |= 1UL << pin;
+    }
+  }
+  return result;
+}
+
+void GPIOWrapper::beginTransaction()
+{
+  if (_private->simulated != NULL) {
+    _private->simulated->beginTransaction();
+    return;
+  }
+  _private->transaction = true;
+}
+
+void GPIOWrapper::commitTransaction()
+{
+  if (_private->simulated != NULL) {
+    _private->simulated->commitTransaction();
+    return;
+  }
+  _private->transaction = false;
+  unsigned long pending = _private->pendingMask;
+  _private->pendingMask = 0;
+  _private->writePins(pending);
 }
 
 unsigned int GPIOWrapper::analogRead(unsigned char pin)
 {
+  if (_private->simulated != NULL) {
+    return _private->simulated->analogRead(pin);
+  }
+  if (pin >= constMaxPins || (_private->validPins & (1UL << pin)) == 0) {
+    return 0;
+  }
   unsigned int result = _private->gpio->AnalogRead(pin);
   return result;
 }
 
 void GPIOWrapper::analogWrite(unsigned char pin, unsigned int value)
 {
-  _private->gpio->AnalogWrite(pin, value);
+  if (pin < constMaxPins) {
+    // the level of the pin depends on the backend, written now even in a transaction
+    _private->outputsKnown &= ~(1UL << pin);
+    _private->pendingMask &= ~(1UL << pin);
+  }
+  if (_private->simulated != NULL) {
+    _private->simulated->analogWrite(pin, value);
+    return;
+  }
+  if (pin >= constMaxPins) {
+    return;
+  }
+  _private->gpio->AnalogWriteIow(_private->iowPins[pin], value);
 }
 
+void GPIOWrapper::attachInterrupt(unsigned char pin, void (*isr)(void), int mode)
+{
+  // no interrupts from the IO-Warrior
+  if (_private->simulated != NULL) {
+    _private->simulated->attachInterrupt(pin, isr, mode);
+  }
+}
+
+void GPIOWrapper::detachInterrupt(unsigned char pin)
+{
+  if (_private->simulated != NULL) {
+    _private->simulated->detachInterrupt(pin);
+  }
+}
+
+unsigned long long GPIOWrapper::interruptMicros()
+{
+  if (_private->simulated != NULL) {
+    return _private->simulated->interruptMicros();
+  }
+  return 0;
+}
@@ -42,7 +42,20 @@ class __declspec(dllexport) GPIOWrapper
   public: unsigned char digitalRead(unsigned char pin);
   public: void digitalWrite(unsigned char pin, unsigned char value);
   public: void digitalWritePort(unsigned char port, unsigned char value);
+  public: unsigned char digitalReadPort(unsigned char port);
+  // Pins 0 to 31 by bit, writes the pins in mask to the levels in values
+  public: void digitalWriteMask(unsigned long mask, unsigned long values);
+  public: unsigned long digitalReadMask(unsigned long mask);
+  // Pin changes until commitTransaction() go out together in one output report
+  public: void beginTransaction();
+  public: void commitTransaction();
 
   public: unsigned int analogRead(unsigned char pin);
   public: void analogWrite(unsigned char pin, unsigned int value);
+
+  // Simulated GPIO only, the handler is called on a thread of the simulation
+  public: void attachInterrupt(unsigned char pin, void (*isr)(void), int mode);
+  public: void detachInterrupt(unsigned char pin);
+  // For a handler, board time in microseconds of the pin change it was called for
+  public: unsigned long long interruptMicros();
 };
\ No newline at end of file
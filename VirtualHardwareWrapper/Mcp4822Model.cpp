@@ -0,0 +1,93 @@
+/*
+  Mcp4822Model.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Mcp4822Model.h"
+
+namespace
+{
+	const unsigned int constChannelB = 0x8000;
+	// 0: 2x gain, 1: 1x gain
+	const unsigned int constGainSelect = 0x2000;
+	// 0: channel shut down
+	const unsigned int constActive = 0x1000;
+	const unsigned int constReferenceMillivolts = 2048;
+}
+
+Mcp4822Model::Mcp4822Model()
+	: _command(0), _bytes(0)
+{
+	for (unsigned int i = 0; i < 2; i++) {
+		_codes[i] = 0;
+		_doubleGain[i] = false;
+		// shut down after power on
+		_active[i] = false;
+	}
+}
+
+unsigned int Mcp4822Model::code(unsigned int channel)
+{
+	return _codes[channel & 1];
+}
+
+unsigned int Mcp4822Model::millivolts(unsigned int channel)
+{
+	channel &= 1;
+	if (!_active[channel]) {
+		return 0;
+	}
+	return (_codes[channel] * constReferenceMillivolts * (_doubleGain[channel] ? 2 : 1) + 2048) / 4096;
+}
+
+void Mcp4822Model::select()
+{
+	_bytes = 0;
+}
+
+void Mcp4822Model::deselect()
+{
+	// an incomplete command is ignored
+	_bytes = 0;
+}
+
+void Mcp4822Model::transfer(const unsigned char* txBuffer, unsigned char* rxBuffer, unsigned int size)
+{
+	for (unsigned int i = 0; i < size; i++) {
+		// no SDO pin
+		rxBuffer[i] = 0x00;
+		_command = ((_command << 8) | txBuffer[i]) & 0xffff;
+		if (++_bytes < 2) {
+			continue;
+		}
+
+		_bytes = 0;
+		unsigned int channel = (_command & constChannelB) != 0 ? 1 : 0;
+		_codes[channel] = _command & 0x0fff;
+		_doubleGain[channel] = (_command & constGainSelect) == 0;
+		_active[channel] = (_command & constActive) != 0;
+	}
+}
@@ -0,0 +1,56 @@
+/*
+  Mcp4822Model.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "SpiDevice.h"
+
+// Model of the MCP4822 dual 12 bit SPI DAC with its internal 2.048 V reference and
+// LDAC tied low: a channel takes its new value with the 16th bit of a command.
+class __declspec(dllexport) Mcp4822Model : public SpiDevice
+{
+private: unsigned int _codes[2];
+private: bool _doubleGain[2];
+private: bool _active[2];
+private: unsigned int _command;
+private: unsigned int _bytes;
+
+public: Mcp4822Model();
+
+	// 12 bit input code of channel A (0) or B (1)
+public: unsigned int code(unsigned int channel);
+
+	// Output voltage of the channel in millivolts, 0 while shut down
+public: unsigned int millivolts(unsigned int channel);
+
+public: virtual void select();
+
+public: virtual void deselect();
+
+public: virtual void transfer(const unsigned char* txBuffer, unsigned char* rxBuffer, unsigned int size);
+};
@@ -0,0 +1,126 @@
+/*
+  MonotonicClock.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+// Monotonic clock for millis() and micros(): QueryPerformanceCounter on Windows,
+// CLOCK_MONOTONIC on POSIX systems. Unaffected by NTP or user changes of the wall clock.
+// Every reading is converted from the raw ticks since the origin, so truncation errors
+// never accumulate, and the 32 bit results wrap around like on an Arduino.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+class MonotonicClock
+{
+private: unsigned long long _origin;
+private: unsigned long long _frequency;
+
+	// Starts counting at zero
+public: MonotonicClock()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		_frequency = frequency.QuadPart;
+#else
+		_frequency = 1000000000ULL;
+#endif
+		_origin = now();
+	}
+
+	// Ticks per second
+public: unsigned long long frequency() const
+	{
+		return _frequency;
+	}
+
+	// Ticks since the origin
+public: unsigned long long ticks() const
+	{
+		return now() - _origin;
+	}
+
+public: unsigned int millis() const
+	{
+		return toMillis(ticks(), _frequency);
+	}
+
+public: unsigned int micros() const
+	{
+		return toMicros(ticks(), _frequency);
+	}
+
+public: static unsigned int toMillis(unsigned long long ticks, unsigned long long frequency)
+	{
+		return (unsigned int)scale(ticks, frequency, 1000ULL);
+	}
+
+public: static unsigned int toMicros(unsigned long long ticks, unsigned long long frequency)
+	{
+		return (unsigned int)scale(ticks, frequency, 1000000ULL);
+	}
+
+	// Microseconds of the system wide clock, comparable between processes
+public: static unsigned long long systemMicros()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return scale(now(), frequency.QuadPart, 1000000ULL);
+#else
+		return now() / 1000ULL;
+#endif
+	}
+
+	// ticks * unitsPerSecond / frequency without overflow, rounded down
+public: static unsigned long long scale(unsigned long long ticks, unsigned long long frequency, unsigned long long unitsPerSecond)
+	{
+		// the usual Windows frequency of 10 MHz and the POSIX 1 GHz need one division only
+		if (frequency % unitsPerSecond == 0) {
+			return ticks / (frequency / unitsPerSecond);
+		}
+		return ticks / frequency * unitsPerSecond + ticks % frequency * unitsPerSecond / frequency;
+	}
+
+private: static unsigned long long now()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return counter.QuadPart;
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+	}
+};
@@ -0,0 +1,306 @@
+/*
+  NodeScheduler.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Native scheduler of ProcessSynchronizationWrapper. The state of all nodes lives in
+// ProcessShared memory, the deadlines are microseconds of the system wide MonotonicClock.
+
+#include "NodeScheduler.h"
+#include "MonotonicClock.h"
+#include "ProcessShared.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const unsigned int constMaxNodes = 256;
+	const unsigned int constMaxLanes = 256;
+	// real time between checks for nodes which died while holding the turn
+	const unsigned int constLivenessCheckMillis = 100;
+
+	const char* constSharedName = "VirtualBoard.NodeScheduler";
+
+	enum NodeState
+	{
+		stateFree = 0,
+		stateWaiting = 1,
+		stateRunning = 2
+	};
+
+	struct SharedNode
+	{
+		int pid;
+		int state;
+		unsigned int lane;
+		unsigned long long deadline;
+		// tie-breaker for equal deadlines
+		unsigned long long order;
+
+		unsigned long long turns;
+		unsigned long long latencyTotal;
+		unsigned long long latencyMax;
+	};
+
+	// valid when zeroed
+	struct SharedState
+	{
+		unsigned long long nextOrder;
+		// node + 1 holding the turn of the lane, 0 if none
+		unsigned int owner[constMaxLanes];
+		SharedNode nodes[constMaxNodes];
+	};
+}
+
+class NodeSchedulerPrivate
+{
+	public: ProcessShared memory;
+	public: SharedState* shared;
+	public: int node;
+	public: unsigned int lane;
+
+	public: NodeSchedulerPrivate()
+		: shared(NULL), node(-1), lane(0)
+	{
+	}
+
+	// Frees the nodes of dead processes, the lock must be held
+	public: void reclaimDeadNodes()
+	{
+		for (unsigned int i = 0; i < constMaxNodes; i++) {
+			SharedNode& other = shared->nodes[i];
+			if (other.state != stateFree && !ProcessShared::processAlive(other.pid)) {
+				other.state = stateFree;
+				if (shared->owner[other.lane] == i + 1) {
+					shared->owner[other.lane] = 0;
+				}
+			}
+		}
+	}
+
+	// Hands a free turn of the lane to the due node with the earliest deadline, the lock must be held
+	public: void dispatch(unsigned int dispatchLane)
+	{
+		if (shared->owner[dispatchLane] != 0) {
+			return;
+		}
+
+		unsigned long long now = MonotonicClock::systemMicros();
+		int next = -1;
+		for (unsigned int i = 0; i < constMaxNodes; i++) {
+			SharedNode& other = shared->nodes[i];
+			if (other.state != stateWaiting || other.lane != dispatchLane || other.deadline > now) {
+				continue;
+			}
+			if (next < 0 || other.deadline < shared->nodes[next].deadline
+				|| (other.deadline == shared->nodes[next].deadline && other.order < shared->nodes[next].order)) {
+				next = i;
+			}
+		}
+		if (next < 0) {
+			return;
+		}
+
+		// a node still sleeping past its deadline takes the turn as soon as it wakes up
+		shared->nodes[next].state = stateRunning;
+		shared->owner[dispatchLane] = next + 1;
+		memory.signal(next);
+	}
+
+	// Blocks until this node holds the turn of its lane, the lock must be held
+	public: void acquireTurn()
+	{
+		SharedNode& self = shared->nodes[node];
+		while (shared->owner[lane] != (unsigned int)node + 1) {
+			dispatch(lane);
+			if (shared->owner[lane] == (unsigned int)node + 1) {
+				break;
+			}
+
+			unsigned int timeout = constLivenessCheckMillis;
+			unsigned long long now = MonotonicClock::systemMicros();
+			if (self.deadline > now && (self.deadline - now + 999) / 1000 < timeout) {
+				timeout = (unsigned int)((self.deadline - now + 999) / 1000);
+			}
+			if (!memory.wait(node, timeout) && self.deadline + constLivenessCheckMillis * 1000ULL < now) {
+				// long overdue, the holder of the turn may be gone
+				reclaimDeadNodes();
+			}
+		}
+
+		unsigned long long now = MonotonicClock::systemMicros();
+		unsigned long long latency = now > self.deadline ? now - self.deadline : 0;
+		self.turns++;
+		self.latencyTotal += latency;
+		if (latency > self.latencyMax) {
+			self.latencyMax = latency;
+		}
+	}
+
+	public: bool attach()
+	{
+		memory.lock();
+		reclaimDeadNodes();
+		for (unsigned int i = 0; i < constMaxNodes; i++) {
+			if (shared->nodes[i].state == stateFree) {
+				node = i;
+				break;
+			}
+		}
+		if (node < 0) {
+			memory.unlock();
+			return false;
+		}
+
+		SharedNode& self = shared->nodes[node];
+		self.pid = ProcessShared::currentProcessId();
+		self.lane = lane;
+		self.deadline = MonotonicClock::systemMicros();
+		self.order = shared->nextOrder++;
+		self.turns = 0;
+		self.latencyTotal = 0;
+		self.latencyMax = 0;
+		self.state = stateWaiting;
+
+		acquireTurn();
+		memory.unlock();
+		return true;
+	}
+
+	public: void detach()
+	{
+		memory.lock();
+		shared->nodes[node].state = stateFree;
+		if (shared->owner[lane] == (unsigned int)node + 1) {
+			shared->owner[lane] = 0;
+			dispatch(lane);
+		}
+		memory.unlock();
+	}
+
+	public: void wait(unsigned int milliseconds)
+	{
+		memory.lock();
+		SharedNode& self = shared->nodes[node];
+		self.deadline = MonotonicClock::systemMicros() + milliseconds * 1000ULL;
+		self.order = shared->nextOrder++;
+		self.state = stateWaiting;
+		shared->owner[lane] = 0;
+		dispatch(lane);
+		acquireTurn();
+		memory.unlock();
+	}
+};
+
+namespace
+{
+	// the node is detached at exit, the instance itself stays for late calls
+	NodeSchedulerPrivate* attachedNode = NULL;
+
+	void detachAtExit()
+	{
+		if (attachedNode != NULL && attachedNode->shared != NULL) {
+			attachedNode->detach();
+			attachedNode->memory.close();
+			attachedNode->shared = NULL;
+		}
+	}
+}
+
+NodeScheduler::NodeScheduler()
+{
+	_private = new NodeSchedulerPrivate();
+
+	const char* lane = getenv("VM_SYNC_LANE");
+	if (lane != NULL) {
+		_private->lane = (unsigned int)strtoul(lane, NULL, 10) % constMaxLanes;
+	}
+
+	if (_private->memory.open(constSharedName, sizeof(SharedState), constMaxNodes)) {
+		_private->shared = (SharedState*)_private->memory.memory();
+	}
+	if (_private->shared == NULL || !_private->attach()) {
+		fprintf(stderr, "NodeScheduler: cannot attach to the shared scheduler, running unsynchronized\n");
+		_private->memory.close();
+		_private->shared = NULL;
+		return;
+	}
+	attachedNode = _private;
+	atexit(detachAtExit);
+}
+
+NodeScheduler::~NodeScheduler()
+{
+	if (attachedNode == _private) {
+		attachedNode = NULL;
+	}
+	if (_private->shared != NULL) {
+		_private->detach();
+	}
+	delete _private;
+}
+
+NodeScheduler& NodeScheduler::instance()
+{
+	static NodeScheduler* nodeScheduler = new NodeScheduler();
+	return *nodeScheduler;
+}
+
+void NodeScheduler::wait(unsigned int milliseconds)
+{
+	if (_private->shared == NULL) {
+		// not attached, nobody else to run
+#ifdef _WIN32
+		Sleep(milliseconds);
+#else
+		usleep(milliseconds * 1000ULL);
+#endif
+		return;
+	}
+	_private->wait(milliseconds);
+}
+
+void NodeScheduler::latency(unsigned long long* turns, unsigned long long* totalMicros, unsigned long long* maxMicros)
+{
+	*turns = 0;
+	*totalMicros = 0;
+	*maxMicros = 0;
+	if (_private->shared == NULL) {
+		return;
+	}
+
+	_private->memory.lock();
+	SharedNode& self = _private->shared->nodes[_private->node];
+	*turns = self.turns;
+	*totalMicros = self.latencyTotal;
+	*maxMicros = self.latencyMax;
+	_private->memory.unlock();
+}
@@ -0,0 +1,61 @@
+/*
+  NodeScheduler.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+// Real time scheduler of the simulated nodes (processes) on this machine.
+//
+// Nodes are grouped in lanes by the environment variable VM_SYNC_LANE (default 0).
+// Within a lane exactly one node runs at a time, nodes of different lanes run in parallel.
+// Nodes which exchange messages must share a lane.
+//
+// A node gives up its turn in wait() and sleeps without holding anything. When its
+// deadline has passed it competes for the turn again. The turn always goes to the due
+// node with the earliest deadline, ties in the order the nodes started to wait, so the
+// order does not depend on which process the OS happens to wake first.
+
+class NodeSchedulerPrivate;
+
+class NodeScheduler
+{
+private: NodeSchedulerPrivate* _private;
+
+private: NodeScheduler();
+
+public: ~NodeScheduler();
+
+	// The node of this process, attached and holding the turn on the first call
+public: static NodeScheduler& instance();
+
+	// Gives up the turn for the milliseconds and waits for it again
+public: void wait(unsigned int milliseconds);
+
+	// Number of turns, and the total and maximal time in microseconds between
+	// the end of a wait() and getting the turn
+public: void latency(unsigned long long* turns, unsigned long long* totalMicros, unsigned long long* maxMicros);
+};
@@ -0,0 +1,84 @@
+/*
+  Pca9555Model.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Pca9555Model.h"
+
+namespace
+{
+	enum Pca9555Register
+	{
+		registerInput0 = 0,
+		registerInput1 = 1,
+		registerOutput0 = 2,
+		registerOutput1 = 3,
+		registerPolarity0 = 4,
+		registerPolarity1 = 5,
+		registerConfiguration0 = 6,
+		registerConfiguration1 = 7
+	};
+
+	const RegisterDefinition constRegisters[] =
+	{
+		{ registerInput0, 2, 0x00, 0x00 },
+		{ registerOutput0, 2, 0xff, 0xff },
+		{ registerPolarity0, 2, 0x00, 0xff },
+		// all pins are inputs after reset
+		{ registerConfiguration0, 2, 0xff, 0xff }
+	};
+}
+
+Pca9555Model::Pca9555Model()
+	: TwiRegisterDevice(constRegisters, sizeof(constRegisters) / sizeof(constRegisters[0]), 1), _inputs(0xffff)
+{
+}
+
+void Pca9555Model::setInputs(unsigned int levels)
+{
+	_inputs = levels & 0xffff;
+}
+
+unsigned int Pca9555Model::pins()
+{
+	unsigned int outputs = registers.value(registerOutput0) | (registers.value(registerOutput1) << 8);
+	unsigned int configuration = registers.value(registerConfiguration0) | (registers.value(registerConfiguration1) << 8);
+	return (outputs & ~configuration & 0xffff) | (_inputs & configuration);
+}
+
+unsigned char Pca9555Model::readRegister(unsigned int address)
+{
+	if (address == registerInput0 || address == registerInput1) {
+		unsigned int port = address - registerInput0;
+		return (unsigned char)((pins() >> (8 * port)) ^ registers.value((unsigned char)(registerPolarity0 + port)));
+	}
+	return TwiRegisterDevice::readRegister(address);
+}
+
+unsigned int Pca9555Model::nextRegister(unsigned int address, bool /*writing*/)
+{
+	return address ^ 1;
+}
@@ -0,0 +1,52 @@
+/*
+  Pca9555Model.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "TwiRegisterDevice.h"
+
+// Model of the PCA9555 16 bit I2C port expander. Reads of the input ports return the
+// levels of the pins: the outputs where configured as output, otherwise the levels set
+// with setInputs(), inverted by the polarity registers. The interrupt output is not modeled.
+class __declspec(dllexport) Pca9555Model : public TwiRegisterDevice
+{
+private: unsigned int _inputs;
+
+public: Pca9555Model();
+
+	// Levels driven into the pins from outside, bit 0 is IO0_0, bit 8 is IO1_0
+public: void setInputs(unsigned int levels);
+
+	// Levels of the 16 pins, undriven inputs read high
+public: unsigned int pins();
+
+protected: virtual unsigned char readRegister(unsigned int address);
+
+	// The pointer toggles within a register pair
+protected: virtual unsigned int nextRegister(unsigned int address, bool writing);
+};
@@ -0,0 +1,344 @@
+/*
+  ProcessShared.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ProcessShared.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifndef _WIN32
+	const unsigned int constMagic = 0x564d5053; // "VMPS"
+	const unsigned int constAlignment = 64;
+
+	// a semaphore instead of a condition variable: it stays usable when a waiter
+	// is killed, and a signal nobody waited for yet is simply its count
+	struct SharedSlot
+	{
+		sem_t wake;
+	};
+
+	// in front of the memory of the caller
+	struct SharedHeader
+	{
+		volatile unsigned int magic;
+		unsigned int size;
+		unsigned int slots;
+		pthread_mutex_t lock;
+	};
+
+	unsigned int alignUp(unsigned int size)
+	{
+		return (size + constAlignment - 1) / constAlignment * constAlignment;
+	}
+#endif
+}
+
+class ProcessSharedPrivate
+{
+	public: void* memory;
+	public: unsigned int size;
+	public: unsigned int slots;
+
+#ifdef _WIN32
+	public: HANDLE mutex;
+	public: HANDLE mapping;
+	public: HANDLE* wake;
+#else
+	public: int fd;
+	public: SharedHeader* header;
+	public: SharedSlot* slot;
+	public: unsigned int mappedSize;
+#endif
+
+	public: ProcessSharedPrivate()
+		: memory(NULL), size(0), slots(0)
+	{
+#ifdef _WIN32
+		mutex = NULL;
+		mapping = NULL;
+		wake = NULL;
+#else
+		fd = -1;
+		header = NULL;
+		slot = NULL;
+		mappedSize = 0;
+#endif
+	}
+};
+
+ProcessShared::ProcessShared()
+{
+	_private = new ProcessSharedPrivate();
+}
+
+ProcessShared::~ProcessShared()
+{
+	close();
+	delete _private;
+}
+
+bool ProcessShared::open(const char* name, unsigned int size, unsigned int slots)
+{
+	_private->size = size;
+	_private->slots = slots;
+
+#ifdef _WIN32
+	char objectName[128];
+	_snprintf_s(objectName, sizeof(objectName), _TRUNCATE, "%s.Lock", name);
+	_private->mutex = CreateMutexA(NULL, FALSE, objectName);
+	if (_private->mutex == NULL) {
+		return false;
+	}
+	// pages of the paging file are zeroed on creation
+	_private->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, name);
+	if (_private->mapping == NULL) {
+		return false;
+	}
+	_private->memory = MapViewOfFile(_private->mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (_private->memory == NULL) {
+		return false;
+	}
+	_private->wake = new HANDLE[slots];
+	memset(_private->wake, 0, slots * sizeof(HANDLE));
+	for (unsigned int i = 0; i < slots; i++) {
+		_snprintf_s(objectName, sizeof(objectName), _TRUNCATE, "%s.Wake%u", name, i);
+		_private->wake[i] = CreateEventA(NULL, FALSE, FALSE, objectName);
+		if (_private->wake[i] == NULL) {
+			return false;
+		}
+	}
+	return true;
+#else
+	char objectName[128];
+	snprintf(objectName, sizeof(objectName), "/%s", name);
+	_private->mappedSize = alignUp(sizeof(SharedHeader)) + alignUp(slots * sizeof(SharedSlot)) + size;
+
+	bool creator = true;
+	_private->fd = shm_open(objectName, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (_private->fd < 0 && errno == EEXIST) {
+		creator = false;
+		_private->fd = shm_open(objectName, O_RDWR, 0600);
+	}
+	if (_private->fd < 0) {
+		return false;
+	}
+	if (creator && ftruncate(_private->fd, _private->mappedSize) != 0) {
+		return false;
+	}
+
+	// the creator may still be resizing
+	struct stat status;
+	for (int i = 0; i < 1000; i++) {
+		if (fstat(_private->fd, &status) == 0 && status.st_size >= (off_t)_private->mappedSize) {
+			break;
+		}
+		usleep(1000);
+	}
+	void* mapped = mmap(NULL, _private->mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, _private->fd, 0);
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+	_private->header = (SharedHeader*)mapped;
+	_private->slot = (SharedSlot*)((char*)mapped + alignUp(sizeof(SharedHeader)));
+	SharedHeader* header = _private->header;
+
+	if (creator) {
+		header->size = size;
+		header->slots = slots;
+
+		pthread_mutexattr_t mutexAttributes;
+		pthread_mutexattr_init(&mutexAttributes);
+		pthread_mutexattr_setpshared(&mutexAttributes, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&mutexAttributes, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&header->lock, &mutexAttributes);
+		pthread_mutexattr_destroy(&mutexAttributes);
+
+		for (unsigned int i = 0; i < slots; i++) {
+			sem_init(&_private->slot[i].wake, 1, 0);
+		}
+
+		__sync_synchronize();
+		header->magic = constMagic;
+	} else {
+		for (int i = 0; i < 1000 && header->magic != constMagic; i++) {
+			usleep(1000);
+		}
+		__sync_synchronize();
+	}
+	if (header->magic != constMagic || header->size != size || header->slots != slots) {
+		// left behind by another version, remove /dev/shm/<name>
+		return false;
+	}
+	_private->memory = (char*)mapped + alignUp(sizeof(SharedHeader)) + alignUp(slots * sizeof(SharedSlot));
+	return true;
+#endif
+}
+
+void ProcessShared::close()
+{
+#ifdef _WIN32
+	if (_private->wake != NULL) {
+		for (unsigned int i = 0; i < _private->slots; i++) {
+			if (_private->wake[i] != NULL) {
+				CloseHandle(_private->wake[i]);
+			}
+		}
+		delete[] _private->wake;
+		_private->wake = NULL;
+	}
+	if (_private->memory != NULL) {
+		UnmapViewOfFile(_private->memory);
+	}
+	if (_private->mapping != NULL) {
+		CloseHandle(_private->mapping);
+		_private->mapping = NULL;
+	}
+	if (_private->mutex != NULL) {
+		CloseHandle(_private->mutex);
+		_private->mutex = NULL;
+	}
+#else
+	if (_private->header != NULL) {
+		munmap(_private->header, _private->mappedSize);
+		_private->header = NULL;
+		_private->slot = NULL;
+	}
+	if (_private->fd >= 0) {
+		::close(_private->fd);
+		_private->fd = -1;
+	}
+#endif
+	_private->memory = NULL;
+}
+
+void* ProcessShared::memory()
+{
+	return _private->memory;
+}
+
+void ProcessShared::lock()
+{
+#ifdef _WIN32
+	// WAIT_ABANDONED: the previous holder died, the mutex is ours anyway
+	WaitForSingleObject(_private->mutex, INFINITE);
+#else
+	if (pthread_mutex_lock(&_private->header->lock) == EOWNERDEAD) {
+		pthread_mutex_consistent(&_private->header->lock);
+	}
+#endif
+}
+
+void ProcessShared::unlock()
+{
+#ifdef _WIN32
+	ReleaseMutex(_private->mutex);
+#else
+	pthread_mutex_unlock(&_private->header->lock);
+#endif
+}
+
+void ProcessShared::signal(unsigned int slot)
+{
+#ifdef _WIN32
+	SetEvent(_private->wake[slot]);
+#else
+	// the lock is held, no other signal can race between the check and the post
+	int count = 0;
+	sem_getvalue(&_private->slot[slot].wake, &count);
+	if (count == 0) {
+		sem_post(&_private->slot[slot].wake);
+	}
+#endif
+}
+
+bool ProcessShared::wait(unsigned int slot, unsigned int milliseconds)
+{
+#ifdef _WIN32
+	unlock();
+	DWORD result = WaitForSingleObject(_private->wake[slot], milliseconds);
+	lock();
+	return result == WAIT_OBJECT_0;
+#else
+	sem_t* wake = &_private->slot[slot].wake;
+	// sem_timedwait() only takes the realtime clock
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (milliseconds % 1000) * 1000000L;
+	deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+	deadline.tv_nsec %= 1000000000L;
+
+	unlock();
+	int result;
+	do {
+		result = sem_timedwait(wake, &deadline);
+	} while (result != 0 && errno == EINTR);
+	lock();
+	return result == 0;
+#endif
+}
+
+int ProcessShared::currentProcessId()
+{
+#ifdef _WIN32
+	return (int)GetCurrentProcessId();
+#else
+	return (int)getpid();
+#endif
+}
+
+bool ProcessShared::processAlive(int pid)
+{
+#ifdef _WIN32
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+	if (process == NULL) {
+		return GetLastError() == ERROR_ACCESS_DENIED;
+	}
+	bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+	CloseHandle(process);
+	return alive;
+#else
+	return kill(pid, 0) == 0 || errno == EPERM;
+#endif
+}
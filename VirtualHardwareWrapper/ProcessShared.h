@@ -0,0 +1,69 @@
+/*
+  ProcessShared.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+// Named shared memory for the boards (processes) of this machine, with a lock and one
+// wake signal per slot. A named mapping, mutex and events on Windows, shm with a robust
+// process-shared mutex and semaphores on POSIX systems.
+// The memory is zeroed when it is created.
+
+class ProcessSharedPrivate;
+
+class ProcessShared
+{
+private: ProcessSharedPrivate* _private;
+
+public: ProcessShared();
+
+public: ~ProcessShared();
+
+	// Creates or opens the memory, all processes must pass the same size and slots
+public: bool open(const char* name, unsigned int size, unsigned int slots);
+
+public: void close();
+
+	// NULL if not open
+public: void* memory();
+
+	// Also succeeds if the previous holder died while holding the lock
+public: void lock();
+
+public: void unlock();
+
+	// Wakes the process waiting on the slot, or makes its next wait() return at once
+public: void signal(unsigned int slot);
+
+	// Waits for a signal of the slot, the lock must be held and is released meanwhile.
+	// Returns false on timeout.
+public: bool wait(unsigned int slot, unsigned int milliseconds);
+
+public: static int currentProcessId();
+
+public: static bool processAlive(int pid);
+};
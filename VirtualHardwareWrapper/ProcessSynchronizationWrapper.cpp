@@ -26,22 +26,34 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-#include <msclr\auto_gcroot.h>
-#include "ProcessSynchronizationWrapper.h"
+// Native implementation: the NodeScheduler replaces the named mutex of ProcessSynchronization,
+// in virtual time mode VirtualTime schedules the nodes instead.
 
-using namespace System::Runtime::InteropServices; // Marshal
-using namespace VirtualHardwareNet;
+#include "ProcessSynchronizationWrapper.h"
+#include "MonotonicClock.h"
+#include "NodeScheduler.h"
+#include "VirtualTime.h"
 
 
 class ProcessSynchronizationWrapperPrivate
 {
-	public: msclr::auto_gcroot<ProcessSynchronization^> procSync;
+	public: MonotonicClock clock;
+	// exactly one of them is set
+	public: NodeScheduler* nodeScheduler;
+	public: VirtualTime* virtualTime;
 };
 
 ProcessSynchronizationWrapper::ProcessSynchronizationWrapper()
 {
 	_private = new ProcessSynchronizationWrapperPrivate();
-	_private->procSync = gcnew ProcessSynchronization();
+	_private->nodeScheduler = NULL;
+	_private->virtualTime = NULL;
+	// both attach this node and wait for its first turn
+	if (VirtualTime::enabled()) {
+		_private->virtualTime = &VirtualTime::instance();
+	} else {
+		_private->nodeScheduler = &NodeScheduler::instance();
+	}
 }
 
 ProcessSynchronizationWrapper::~ProcessSynchronizationWrapper()
@@ -51,10 +63,31 @@ ProcessSynchronizationWrapper::~ProcessSynchronizationWrapper()
 
 unsigned int ProcessSynchronizationWrapper::wait(unsigned int milliseconds)
 {
-	return _private->procSync->Wait(milliseconds);
+	if (_private->virtualTime != NULL) {
+		_private->virtualTime->sleep(milliseconds * 1000ULL);
+	} else {
+		_private->nodeScheduler->wait(milliseconds);
+	}
+	return millis();
 }
 
 unsigned int ProcessSynchronizationWrapper::millis()
 {
-	return _private->procSync->Millis();
+	if (_private->virtualTime != NULL) {
+		return (unsigned int)(_private->virtualTime->micros() / 1000);
+	}
+	return _private->clock.millis();
+}
+
+void ProcessSynchronizationWrapper::schedulingLatency(unsigned long* turns, unsigned long* averageMicros, unsigned long* maxMicros)
+{
+	unsigned long long turnCount = 0;
+	unsigned long long totalMicros = 0;
+	unsigned long long maxLatency = 0;
+	if (_private->nodeScheduler != NULL) {
+		_private->nodeScheduler->latency(&turnCount, &totalMicros, &maxLatency);
+	}
+	*turns = (unsigned long)turnCount;
+	*averageMicros = turnCount > 0 ? (unsigned long)(totalMicros / turnCount) : 0;
+	*maxMicros = (unsigned long)maxLatency;
 }
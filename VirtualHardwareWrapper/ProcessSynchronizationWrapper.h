@@ -43,4 +43,8 @@ public: ~ProcessSynchronizationWrapper();
 public: unsigned int wait(unsigned int milliseconds);
 
 public: unsigned int millis();
+
+	// Turns of this node so far, and the average and maximal delay in microseconds
+	// between the end of a wait() and getting the turn. Zero in virtual time mode.
+public: void schedulingLatency(unsigned long* turns, unsigned long* averageMicros, unsigned long* maxMicros);
 };
@@ -0,0 +1,80 @@
+/*
+  RegisterMap.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "RegisterMap.h"
+
+#include <string.h>
+
+RegisterMap::RegisterMap(const RegisterDefinition* definitions, unsigned int count)
+{
+	memset(_resetValues, 0xff, sizeof(_resetValues));
+	memset(_writeMasks, 0, sizeof(_writeMasks));
+	memset(_defined, 0, sizeof(_defined));
+	for (unsigned int i = 0; i < count; i++) {
+		const RegisterDefinition& definition = definitions[i];
+		for (unsigned int j = 0; j < definition.count && definition.address + j < 256; j++) {
+			unsigned int address = definition.address + j;
+			_resetValues[address] = definition.resetValue;
+			_writeMasks[address] = definition.writeMask;
+			_defined[address] = true;
+		}
+	}
+	reset();
+}
+
+void RegisterMap::reset()
+{
+	memcpy(_values, _resetValues, sizeof(_values));
+}
+
+bool RegisterMap::defined(unsigned char address) const
+{
+	return _defined[address];
+}
+
+unsigned char RegisterMap::value(unsigned char address) const
+{
+	return _values[address];
+}
+
+void RegisterMap::setValue(unsigned char address, unsigned char value)
+{
+	if (_defined[address]) {
+		_values[address] = value;
+	}
+}
+
+bool RegisterMap::write(unsigned char address, unsigned char value)
+{
+	if (!_defined[address]) {
+		return false;
+	}
+	unsigned char mask = _writeMasks[address];
+	_values[address] = (unsigned char)((_values[address] & ~mask) | (value & mask));
+	return true;
+}
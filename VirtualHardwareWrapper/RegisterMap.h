@@ -0,0 +1,65 @@
+/*
+  RegisterMap.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+// Declaration of a register or a range of registers of a simulated chip
+struct RegisterDefinition
+{
+	unsigned char address;
+	// number of consecutive registers with the same properties
+	unsigned char count;
+	unsigned char resetValue;
+	// bits the master may change, 0x00 for read-only registers
+	unsigned char writeMask;
+};
+
+// The 8 bit registers of a simulated chip, declared by a table of RegisterDefinition.
+// Undeclared registers read 0xff and ignore writes.
+class __declspec(dllexport) RegisterMap
+{
+private: unsigned char _values[256];
+private: unsigned char _resetValues[256];
+private: unsigned char _writeMasks[256];
+private: bool _defined[256];
+
+public: RegisterMap(const RegisterDefinition* definitions, unsigned int count);
+
+	// All registers to their reset values
+public: void reset();
+
+public: bool defined(unsigned char address) const;
+
+public: unsigned char value(unsigned char address) const;
+
+	// Changes the register from the chip side, read-only bits included
+public: void setValue(unsigned char address, unsigned char value);
+
+	// Changes the writable bits as the master does, returns false for undeclared registers
+public: bool write(unsigned char address, unsigned char value);
+};
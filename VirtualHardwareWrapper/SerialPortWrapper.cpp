@@ -26,6 +26,9 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+// Build with VM_SERIAL_NATIVE to use the CLR free backend in SerialPortWrapperNative.cpp
+#ifndef VM_SERIAL_NATIVE
+
 #include <msclr\auto_gcroot.h>
 #include "SerialPortWrapper.h"
 
@@ -50,6 +53,21 @@ SerialPortWrapper::~SerialPortWrapper()
 	delete _private;
 }
 
+unsigned int SerialPortWrapper::setRxBufferSize(unsigned int size)
+{
+	return _private->serial->setRxBufferSize(size);
+}
+
+unsigned int SerialPortWrapper::setTxBufferSize(unsigned int size)
+{
+	return _private->serial->setTxBufferSize(size);
+}
+
+void SerialPortWrapper::setWriteTimeout(unsigned int milliseconds)
+{
+	_private->serial->setWriteTimeout(milliseconds);
+}
+
 void SerialPortWrapper::begin(const char *portName, int baudRate, unsigned char config)
 {
 	_private->serial->begin(gcnew System::String(portName), baudRate, config);
@@ -77,17 +95,13 @@ void SerialPortWrapper::end()
 
 unsigned int SerialPortWrapper::write(const unsigned char * buf, unsigned int size)
 {
-	array<unsigned char>^ data = gcnew array<unsigned char>(size);
-	Marshal::Copy(System::IntPtr((void *)buf), data, 0, size);
-	return _private->serial->write(data, size);
+	// SerialPortNet reads straight from the caller's memory, no managed copy needed
+	return _private->serial->write((unsigned char *)buf, size);
 }
 
 int SerialPortWrapper::read(unsigned char * buf, unsigned int bytes)
 {
-	array<unsigned char>^ data = gcnew array<unsigned char>(bytes);
-	int result = _private->serial->read(data, bytes);
-	if (result > 0) {
-		Marshal::Copy(data, 0, System::IntPtr((void *)buf), result);
-	}
-	return result;
+	return _private->serial->read(buf, bytes);
 }
+
+#endif // !VM_SERIAL_NATIVE
@@ -30,9 +30,16 @@
 
 //using namespace System;
 
+// SerialPortWrapperNative.cpp is the only backend that builds outside of MSVC
+#ifdef _MSC_VER
+#define VM_SERIAL_EXPORT __declspec(dllexport)
+#else
+#define VM_SERIAL_EXPORT
+#endif
+
 class SerialPortWrapperPrivate;
 
-class __declspec(dllexport) SerialPortWrapper
+class VM_SERIAL_EXPORT SerialPortWrapper
 {
 private:
 	SerialPortWrapperPrivate* _private;
@@ -40,6 +47,9 @@ private:
 public:
 	SerialPortWrapper();
 	~SerialPortWrapper();
+	unsigned int setRxBufferSize(unsigned int size);
+	unsigned int setTxBufferSize(unsigned int size);
+	void setWriteTimeout(unsigned int milliseconds);
 	void begin(const char *portName, int baudRate, unsigned char config);
 
 	int available();
@@ -0,0 +1,536 @@
+/*
+  SerialPortWrapperNative.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Native serial backend, talks to the OS driver without SerialPortNet and the CLR.
+// Win32 comm API on Windows, termios on POSIX systems (testable against a pty pair).
+// There is no worker thread, the driver buffers the data and every call goes
+// straight to it from the sketch thread.
+
+#ifdef VM_SERIAL_NATIVE
+
+#include "SerialPortWrapper.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const unsigned int constBufferSize = 128;
+	const unsigned int constMaxBufferSize = 1 << 20;
+
+	// Arduino SERIAL_xxx config byte, e.g. SERIAL_8N1 = 0x06
+	const unsigned char constConfigStopBits2 = 0x08;
+	const unsigned char constConfigParityMask = 0x30;
+	const unsigned char constConfigParityEven = 0x20;
+	const unsigned char constConfigParityOdd = 0x30;
+
+	unsigned int roundUpToPowerOfTwo(unsigned int size)
+	{
+		unsigned int capacity = 1;
+		while (capacity < size) {
+			capacity <<= 1;
+		}
+		return capacity;
+	}
+
+	int configDataBits(unsigned char config)
+	{
+		// SerialPortNet ignores config, treat 0 (5N1) as "not set" for the same sketches
+		if (config == 0) {
+			return 8;
+		}
+		return 5 + ((config >> 1) & 0x03);
+	}
+
+#ifndef _WIN32
+	bool toSpeed(int baudRate, speed_t &speed)
+	{
+		switch (baudRate) {
+		case 300: speed = B300; return true;
+		case 600: speed = B600; return true;
+		case 1200: speed = B1200; return true;
+		case 2400: speed = B2400; return true;
+		case 4800: speed = B4800; return true;
+		case 9600: speed = B9600; return true;
+		case 19200: speed = B19200; return true;
+		case 38400: speed = B38400; return true;
+		case 57600: speed = B57600; return true;
+		case 115200: speed = B115200; return true;
+#ifdef B230400
+		case 230400: speed = B230400; return true;
+#endif
+#ifdef B460800
+		case 460800: speed = B460800; return true;
+#endif
+#ifdef B500000
+		case 500000: speed = B500000; return true;
+#endif
+#ifdef B921600
+		case 921600: speed = B921600; return true;
+#endif
+#ifdef B1000000
+		case 1000000: speed = B1000000; return true;
+#endif
+#ifdef B2000000
+		case 2000000: speed = B2000000; return true;
+#endif
+		default: return false;
+		}
+	}
+
+	long long monotonicMillis()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	}
+#endif
+}
+
+class SerialPortWrapperPrivate
+{
+public:
+#ifdef _WIN32
+	HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+	int fd = -1;
+#endif
+	// bytes fetched from the driver, not yet read by the sketch
+	unsigned char *rxBuffer = nullptr;
+	unsigned int rxBufferSize = constBufferSize;
+	unsigned int rxHead = 0;
+	unsigned int rxTail = 0;
+	unsigned int txBufferSize = constBufferSize;
+	unsigned int writeTimeout = 0;
+#ifdef _WIN32
+	// transmit queue of the driver, 0 if it does not report one
+	DWORD txQueueSize = 0;
+#endif
+
+	~SerialPortWrapperPrivate()
+	{
+		close();
+	}
+
+	bool isOpen() const
+	{
+#ifdef _WIN32
+		return handle != INVALID_HANDLE_VALUE;
+#else
+		return fd != -1;
+#endif
+	}
+
+	bool open(const char *portName, int baudRate, unsigned char config);
+	void close();
+	int readDriver(unsigned char *buf, unsigned int size);
+	unsigned int writeDriver(const unsigned char *buf, unsigned int size);
+	void drain();
+#ifdef _WIN32
+	bool applyWriteTimeout();
+#endif
+
+	unsigned int buffered() const
+	{
+		return rxTail - rxHead;
+	}
+
+	// top up the local receive buffer with whatever the driver holds
+	void fill()
+	{
+		if (rxHead == rxTail) {
+			rxHead = rxTail = 0;
+		}
+		else if (rxTail == rxBufferSize && rxHead > 0) {
+			memmove(rxBuffer, rxBuffer + rxHead, rxTail - rxHead);
+			rxTail -= rxHead;
+			rxHead = 0;
+		}
+		if (rxTail < rxBufferSize) {
+			int count = readDriver(rxBuffer + rxTail, rxBufferSize - rxTail);
+			if (count > 0) {
+				rxTail += count;
+			}
+		}
+	}
+};
+
+#ifdef _WIN32
+
+bool SerialPortWrapperPrivate::open(const char *portName, int baudRate, unsigned char config)
+{
+	// "\\.\" prefix is required for COM10 and above
+	char path[MAX_PATH];
+	if (strncmp(portName, "\\\\.\\", 4) == 0) {
+		strncpy_s(path, portName, _TRUNCATE);
+	}
+	else {
+		strcpy_s(path, "\\\\.\\");
+		strncat_s(path, portName, _TRUNCATE);
+	}
+
+	handle = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	// only a hint for the driver, most of them ignore it
+	SetupComm(handle, rxBufferSize, txBufferSize);
+	COMMPROP properties;
+	memset(&properties, 0, sizeof(properties));
+	txQueueSize = GetCommProperties(handle, &properties) ? properties.dwCurrentTxQueue : 0;
+
+	DCB dcb;
+	memset(&dcb, 0, sizeof(dcb));
+	dcb.DCBlength = sizeof(dcb);
+	GetCommState(handle, &dcb);
+	dcb.BaudRate = baudRate;
+	dcb.ByteSize = (BYTE)configDataBits(config);
+	dcb.StopBits = (config & constConfigStopBits2) ? TWOSTOPBITS : ONESTOPBIT;
+	switch (config & constConfigParityMask) {
+	case constConfigParityEven: dcb.Parity = EVENPARITY; break;
+	case constConfigParityOdd: dcb.Parity = ODDPARITY; break;
+	default: dcb.Parity = NOPARITY; break;
+	}
+	dcb.fBinary = TRUE;
+	dcb.fParity = dcb.Parity != NOPARITY;
+	dcb.fOutxCtsFlow = FALSE;
+	dcb.fOutxDsrFlow = FALSE;
+	dcb.fDtrControl = DTR_CONTROL_ENABLE;
+	dcb.fRtsControl = RTS_CONTROL_ENABLE;
+	dcb.fOutX = FALSE;
+	dcb.fInX = FALSE;
+	dcb.fAbortOnError = FALSE;
+
+	if (!SetCommState(handle, &dcb) || !applyWriteTimeout()) {
+		close();
+		return false;
+	}
+	PurgeComm(handle, PURGE_RXCLEAR | PURGE_TXCLEAR);
+	return true;
+}
+
+// ReadFile returns at once with what is there, WriteFile blocks at most writeTimeout.
+// Both write totals 0 would disable the timeout, so a timeout of 0 waits 1 ms at most.
+bool SerialPortWrapperPrivate::applyWriteTimeout()
+{
+	COMMTIMEOUTS timeouts;
+	memset(&timeouts, 0, sizeof(timeouts));
+	timeouts.ReadIntervalTimeout = MAXDWORD;
+	timeouts.WriteTotalTimeoutConstant = writeTimeout > 0 ? writeTimeout : 1;
+	return SetCommTimeouts(handle, &timeouts) != FALSE;
+}
+
+void SerialPortWrapperPrivate::close()
+{
+	if (handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(handle);
+		handle = INVALID_HANDLE_VALUE;
+	}
+}
+
+int SerialPortWrapperPrivate::readDriver(unsigned char *buf, unsigned int size)
+{
+	DWORD count = 0;
+	if (!ReadFile(handle, buf, size, &count, NULL)) {
+		return -1;
+	}
+	return (int)count;
+}
+
+unsigned int SerialPortWrapperPrivate::writeDriver(const unsigned char *buf, unsigned int size)
+{
+	if (writeTimeout == 0 && txQueueSize > 0) {
+		// only the bytes that fit into the transmit queue, same contract as SerialPortNet.setWriteTimeout()
+		COMSTAT status;
+		DWORD errors;
+		if (ClearCommError(handle, &errors, &status)) {
+			DWORD space = status.cbOutQue < txQueueSize ? txQueueSize - status.cbOutQue : 0;
+			if (space == 0) {
+				return 0;
+			}
+			if (size > space) {
+				size = space;
+			}
+		}
+	}
+
+	DWORD count = 0;
+	WriteFile(handle, buf, size, &count, NULL);
+	return count;
+}
+
+void SerialPortWrapperPrivate::drain()
+{
+	FlushFileBuffers(handle);
+}
+
+#else
+
+bool SerialPortWrapperPrivate::open(const char *portName, int baudRate, unsigned char config)
+{
+	speed_t speed;
+	if (!toSpeed(baudRate, speed)) {
+		return false;
+	}
+
+	fd = ::open(portName, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd == -1) {
+		return false;
+	}
+
+	struct termios tio;
+	if (tcgetattr(fd, &tio) != 0) {
+		close();
+		return false;
+	}
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+
+	tio.c_cflag &= ~(CSIZE | CSTOPB | PARENB | PARODD | CRTSCTS);
+	switch (configDataBits(config)) {
+	case 5: tio.c_cflag |= CS5; break;
+	case 6: tio.c_cflag |= CS6; break;
+	case 7: tio.c_cflag |= CS7; break;
+	default: tio.c_cflag |= CS8; break;
+	}
+	if (config & constConfigStopBits2) {
+		tio.c_cflag |= CSTOPB;
+	}
+	switch (config & constConfigParityMask) {
+	case constConfigParityEven: tio.c_cflag |= PARENB; break;
+	case constConfigParityOdd: tio.c_cflag |= PARENB | PARODD; break;
+	default: break;
+	}
+	tio.c_cflag |= CLOCAL | CREAD;
+	// non blocking anyway, but keep read() from waiting for a minimum count
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+
+	if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+		close();
+		return false;
+	}
+	tcflush(fd, TCIOFLUSH);
+	return true;
+}
+
+void SerialPortWrapperPrivate::close()
+{
+	if (fd != -1) {
+		::close(fd);
+		fd = -1;
+	}
+}
+
+int SerialPortWrapperPrivate::readDriver(unsigned char *buf, unsigned int size)
+{
+	ssize_t count;
+	do {
+		count = ::read(fd, buf, size);
+	} while (count < 0 && errno == EINTR);
+	return count < 0 ? -1 : (int)count;
+}
+
+unsigned int SerialPortWrapperPrivate::writeDriver(const unsigned char *buf, unsigned int size)
+{
+	unsigned int sent = 0;
+	long long deadline = writeTimeout > 0 ? monotonicMillis() + writeTimeout : 0;
+	while (sent < size) {
+		ssize_t count = ::write(fd, buf + sent, size - sent);
+		if (count > 0) {
+			sent += (unsigned int)count;
+			continue;
+		}
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			break;
+		}
+
+		// driver buffer is full, same contract as SerialPortNet.setWriteTimeout()
+		if (writeTimeout == 0) {
+			break;
+		}
+		long long remaining = deadline - monotonicMillis();
+		if (remaining <= 0) {
+			break;
+		}
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, (int)remaining) < 0 && errno != EINTR) {
+			break;
+		}
+	}
+	return sent;
+}
+
+void SerialPortWrapperPrivate::drain()
+{
+	tcdrain(fd);
+}
+
+#endif
+
+SerialPortWrapper::SerialPortWrapper()
+{
+	_private = new SerialPortWrapperPrivate();
+}
+
+SerialPortWrapper::~SerialPortWrapper()
+{
+	delete[] _private->rxBuffer;
+	delete _private;
+}
+
+unsigned int SerialPortWrapper::setRxBufferSize(unsigned int size)
+{
+	if (_private->isOpen() || size == 0 || size > constMaxBufferSize) {
+		return 0;
+	}
+	_private->rxBufferSize = roundUpToPowerOfTwo(size);
+	return _private->rxBufferSize;
+}
+
+unsigned int SerialPortWrapper::setTxBufferSize(unsigned int size)
+{
+	// outgoing bytes are buffered by the driver only, the size is passed on as a hint
+	if (_private->isOpen() || size == 0 || size > constMaxBufferSize) {
+		return 0;
+	}
+	_private->txBufferSize = roundUpToPowerOfTwo(size);
+	return _private->txBufferSize;
+}
+
+void SerialPortWrapper::setWriteTimeout(unsigned int milliseconds)
+{
+	_private->writeTimeout = milliseconds;
+#ifdef _WIN32
+	if (_private->isOpen()) {
+		_private->applyWriteTimeout();
+	}
+#endif
+}
+
+void SerialPortWrapper::begin(const char *portName, int baudRate, unsigned char config)
+{
+	end();
+
+	delete[] _private->rxBuffer;
+	_private->rxBuffer = new unsigned char[_private->rxBufferSize];
+	_private->rxHead = _private->rxTail = 0;
+
+	_private->open(portName, baudRate, config);
+}
+
+int SerialPortWrapper::available()
+{
+	if (!_private->isOpen()) {
+		return 0;
+	}
+	_private->fill();
+	return _private->buffered();
+}
+
+int SerialPortWrapper::peek()
+{
+	if (!_private->isOpen()) {
+		return -1;
+	}
+	if (_private->buffered() == 0) {
+		_private->fill();
+		if (_private->buffered() == 0) {
+			return -1;
+		}
+	}
+	return _private->rxBuffer[_private->rxHead];
+}
+
+void SerialPortWrapper::flush()
+{
+	if (_private->isOpen()) {
+		_private->drain();
+	}
+}
+
+void SerialPortWrapper::end()
+{
+	_private->close();
+	_private->rxHead = _private->rxTail = 0;
+}
+
+unsigned int SerialPortWrapper::write(const unsigned char * buf, unsigned int size)
+{
+	if (!_private->isOpen() || size == 0) {
+		return 0;
+	}
+	return _private->writeDriver(buf, size);
+}
+
+int SerialPortWrapper::read(unsigned char * buf, unsigned int bytes)
+{
+	if (!_private->isOpen() || bytes == 0) {
+		return -1;
+	}
+
+	if (_private->buffered() == 0) {
+		// large reads go straight into the caller's memory
+		if (bytes >= _private->rxBufferSize) {
+			int count = _private->readDriver(buf, bytes);
+			return count > 0 ? count : -1;
+		}
+		_private->fill();
+	}
+
+	unsigned int length = _private->buffered();
+	if (length == 0) {
+		return -1;
+	}
+	if (length > bytes) {
+		length = bytes;
+	}
+	memcpy(buf, _private->rxBuffer + _private->rxHead, length);
+	_private->rxHead += length;
+	return length;
+}
+
+#endif // VM_SERIAL_NATIVE
@@ -0,0 +1,549 @@
+/*
+  SimulatedGpio.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SimulatedGpio.h"
+#include "MonotonicClock.h"
+#include "VirtualTime.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const unsigned int constMaxPins = 64;
+
+	// modes of the Arduino core
+	const unsigned char constModeOutput = 1;
+	const unsigned char constModeInputPullup = 2;
+
+	// modes of attachInterrupt()
+	const int constInterruptLow = 0;
+	const int constInterruptChange = 1;
+	const int constInterruptFalling = 2;
+	const int constInterruptRising = 3;
+
+	const unsigned int constMaxEvents = 256;
+	// time of a pin change for queueChanges(), read the clock if a handler needs it.
+	// The board reads it like micros(), a test bench thread without advancing virtual time.
+	const unsigned long long constNow = ~0ULL;
+	const unsigned long long constBenchNow = ~1ULL;
+
+	// port numbers of the AVR core
+	const unsigned char constPortB = 2;
+	const unsigned char constPortC = 3;
+	const unsigned char constPortD = 4;
+
+	// first pin and number of pins of a port
+	bool portPins(unsigned char port, unsigned char* first, unsigned char* count)
+	{
+		switch (port) {
+		case constPortB:
+			*first = 8;
+			*count = 6;
+			return true;
+		case constPortC:
+			*first = 14;
+			*count = 6;
+			return true;
+		case constPortD:
+			*first = 0;
+			*count = 8;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	unsigned long long pinBit(unsigned char pin)
+	{
+		return pin < constMaxPins ? 1ULL << pin : 0;
+	}
+
+	struct PinEvent
+	{
+		unsigned char pin;
+		unsigned long long micros;
+	};
+
+	struct StimulusLine
+	{
+		unsigned long long micros;
+		unsigned char pin;
+		bool level;
+	};
+
+	// Lines "<microseconds> <pin> <0|1>" of VM_GPIO_STIMULUS
+	std::vector<StimulusLine> loadStimulus(const char* path)
+	{
+		std::vector<StimulusLine> lines;
+		FILE* file = path != NULL ? fopen(path, "r") : NULL;
+		if (file == NULL) {
+			if (path != NULL) {
+				fprintf(stderr, "SimulatedGpio: cannot open stimulus %s\n", path);
+			}
+			return lines;
+		}
+		char text[256];
+		while (fgets(text, sizeof(text), file) != NULL) {
+			char* comment = strchr(text, '#');
+			if (comment != NULL) {
+				*comment = '\0';
+			}
+			unsigned long long micros;
+			unsigned int pin, level;
+			if (sscanf(text, "%llu %u %u", &micros, &pin, &level) == 3 && pin < constMaxPins) {
+				StimulusLine line = { micros, (unsigned char)pin, level != 0 };
+				lines.push_back(line);
+			}
+		}
+		fclose(file);
+		return lines;
+	}
+}
+
+class SimulatedGpioPrivate
+{
+	public: std::mutex lock;
+	public: unsigned long long outputMode;
+	public: unsigned long long pullup;
+	public: unsigned long long outputs;
+	public: unsigned long long driven;
+	public: unsigned long long inputs;
+	public: unsigned int analogInputs[constMaxPins];
+	public: unsigned int analogOutputs[constMaxPins];
+	public: unsigned long long reports;
+
+	public: bool transaction;
+	public: unsigned long long pendingMask;
+	public: unsigned long long pendingValues;
+
+	// the board clock, NULL in real time mode
+	public: VirtualTime* virtualTime;
+	public: MonotonicClock clock;
+
+	// pin changes for the handlers of attachInterrupt(), a ring
+	public: void (*handlers[constMaxPins])(void);
+	public: int handlerModes[constMaxPins];
+	public: unsigned long long attached;
+	public: PinEvent events[constMaxEvents];
+	public: unsigned int eventHead;
+	public: unsigned int eventCount;
+	public: unsigned long dropped;
+	public: std::condition_variable wake;
+	public: std::thread dispatcher;
+	public: bool running;
+	public: std::atomic<unsigned long long> currentMicros;
+
+	public: std::vector<StimulusLine> stimulus;
+	public: size_t nextStimulus;
+
+	public: SimulatedGpioPrivate()
+		: outputMode(0), pullup(0), outputs(0), driven(0), inputs(0), reports(0),
+		transaction(false), pendingMask(0), pendingValues(0),
+		virtualTime(VirtualTime::enabled() ? &VirtualTime::instance() : NULL),
+		attached(0), eventHead(0), eventCount(0), dropped(0), running(false), currentMicros(0),
+		stimulus(loadStimulus(getenv("VM_GPIO_STIMULUS"))), nextStimulus(0)
+	{
+		memset(analogInputs, 0, sizeof(analogInputs));
+		memset(analogOutputs, 0, sizeof(analogOutputs));
+		memset(handlers, 0, sizeof(handlers));
+		memset(handlerModes, 0, sizeof(handlerModes));
+	}
+
+	public: unsigned long long boardMicros()
+	{
+		if (virtualTime != NULL) {
+			return virtualTime->micros();
+		}
+		return MonotonicClock::scale(clock.ticks(), clock.frequency(), 1000000ULL);
+	}
+
+	public: unsigned long long benchMicros()
+	{
+		if (virtualTime != NULL) {
+			return virtualTime->peekMicros();
+		}
+		return MonotonicClock::scale(clock.ticks(), clock.frequency(), 1000000ULL);
+	}
+
+	// The lock must be held
+	public: void write(unsigned long long mask, unsigned long long values)
+	{
+		if (transaction) {
+			pendingMask |= mask;
+			pendingValues = (pendingValues & ~mask) | (values & mask);
+			return;
+		}
+		unsigned long long before = levels();
+		outputs = (outputs & ~mask) | (values & mask);
+		reports++;
+		queueChanges(before, constNow);
+	}
+
+	// Queues the level changes since before for their handlers, the lock must be held
+	public: void queueChanges(unsigned long long before, unsigned long long micros)
+	{
+		unsigned long long after = levels();
+		unsigned long long changed = (before ^ after) & attached;
+		if (changed != 0 && micros == constNow) {
+			micros = boardMicros();
+		} else if (changed != 0 && micros == constBenchNow) {
+			micros = benchMicros();
+		}
+		for (unsigned char pin = 0; changed != 0; pin++, changed >>= 1) {
+			if ((changed & 1) == 0) {
+				continue;
+			}
+			bool level = (after & pinBit(pin)) != 0;
+			int mode = handlerModes[pin];
+			if (mode == constInterruptChange || (mode == constInterruptRising && level)
+				|| ((mode == constInterruptFalling || mode == constInterruptLow) && !level)) {
+				if (eventCount == constMaxEvents) {
+					dropped++;
+					continue;
+				}
+				PinEvent& event = events[(eventHead + eventCount) % constMaxEvents];
+				event.pin = pin;
+				event.micros = micros;
+				eventCount++;
+				wake.notify_one();
+			}
+		}
+	}
+
+	// The lock must be held
+	public: void setInput(unsigned char pin, bool level, unsigned long long micros)
+	{
+		unsigned long long before = levels();
+		unsigned long long bit = pinBit(pin);
+		driven |= bit;
+		inputs = level ? inputs | bit : inputs & ~bit;
+		queueChanges(before, micros);
+	}
+
+	// Applies the stimulus lines due at the board time now, the lock must be held
+	public: void applyStimulus(unsigned long long now)
+	{
+		while (nextStimulus < stimulus.size() && stimulus[nextStimulus].micros <= now) {
+			const StimulusLine& line = stimulus[nextStimulus++];
+			setInput(line.pin, line.level, line.micros);
+		}
+	}
+
+	// In virtual time the board applies the stimulus itself, the lock must be held
+	public: void pollStimulus()
+	{
+		if (virtualTime != NULL && nextStimulus < stimulus.size()) {
+			applyStimulus(virtualTime->micros());
+		}
+	}
+
+	// Never two dispatchers at a time: a handler restarting the interrupts keeps its thread,
+	// any other caller first waits until a stopped dispatcher has returned from its handler
+	public: void startDispatcher(std::unique_lock<std::mutex>& guard)
+	{
+		if (running) {
+			return;
+		}
+		if (dispatcher.joinable() && dispatcher.get_id() != std::this_thread::get_id()) {
+			std::thread stopped = std::move(dispatcher);
+			guard.unlock();
+			stopped.join();
+			guard.lock();
+			if (running) {
+				return;
+			}
+		}
+		running = true;
+		if (!dispatcher.joinable()) {
+			dispatcher = std::thread(&SimulatedGpioPrivate::dispatch, this);
+		}
+	}
+
+	// Thread calling the handlers, in real time mode it also plays the stimulus
+	public: void dispatch()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		// a thread replaced while in a handler ends when it returns
+		while (running && dispatcher.get_id() == std::this_thread::get_id()) {
+			if (virtualTime == NULL) {
+				applyStimulus(boardMicros());
+			}
+			if (eventCount == 0) {
+				if (virtualTime == NULL && nextStimulus < stimulus.size()) {
+					unsigned long long now = boardMicros();
+					unsigned long long due = stimulus[nextStimulus].micros;
+					wake.wait_for(guard, std::chrono::microseconds(due > now ? due - now : 0));
+				} else {
+					wake.wait(guard);
+				}
+				continue;
+			}
+			PinEvent event = events[eventHead];
+			eventHead = (eventHead + 1) % constMaxEvents;
+			eventCount--;
+			void (*handler)(void) = handlers[event.pin];
+			if (handler == NULL) {
+				continue;
+			}
+			guard.unlock();
+			currentMicros = event.micros;
+			handler();
+			guard.lock();
+		}
+	}
+
+	// The lock must be held
+	public: unsigned long long levels()
+	{
+		unsigned long long undriven = ~driven & pullup;
+		return (outputs & outputMode) | (~outputMode & ((inputs & driven) | undriven));
+	}
+};
+
+SimulatedGpio::SimulatedGpio()
+{
+	_private = new SimulatedGpioPrivate();
+	if (_private->virtualTime == NULL && !_private->stimulus.empty()) {
+		std::unique_lock<std::mutex> guard(_private->lock);
+		_private->startDispatcher(guard);
+	}
+}
+
+SimulatedGpio::~SimulatedGpio()
+{
+	stopInterrupts();
+	delete _private;
+}
+
+SimulatedGpio& SimulatedGpio::instance()
+{
+	static SimulatedGpio* simulatedGpio = new SimulatedGpio();
+	return *simulatedGpio;
+}
+
+bool SimulatedGpio::selected(const char* serialNumber)
+{
+	const char* gpio = getenv("VM_GPIO");
+	return (serialNumber != NULL && strcmp(serialNumber, "SIMULATED") == 0)
+		|| (gpio != NULL && strcmp(gpio, "SIMULATED") == 0);
+}
+
+void SimulatedGpio::pinMode(unsigned char pin, unsigned char mode)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->pollStimulus();
+	unsigned long long before = _private->levels();
+	unsigned long long bit = pinBit(pin);
+	_private->outputMode = mode == constModeOutput ? _private->outputMode | bit : _private->outputMode & ~bit;
+	_private->pullup = mode == constModeInputPullup ? _private->pullup | bit : _private->pullup & ~bit;
+	_private->queueChanges(before, constNow);
+}
+
+unsigned char SimulatedGpio::digitalRead(unsigned char pin)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->pollStimulus();
+	return (_private->levels() & pinBit(pin)) != 0 ? 1 : 0;
+}
+
+void SimulatedGpio::digitalWrite(unsigned char pin, unsigned char value)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->write(pinBit(pin), value != 0 ? pinBit(pin) : 0);
+}
+
+void SimulatedGpio::digitalWriteMask(unsigned long mask, unsigned long values)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->write(mask & 0xffffffffUL, values);
+}
+
+unsigned long SimulatedGpio::digitalReadMask(unsigned long mask)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->pollStimulus();
+	return (unsigned long)(_private->levels() & mask & 0xffffffffUL);
+}
+
+void SimulatedGpio::digitalWritePort(unsigned char port, unsigned char value)
+{
+	unsigned char first, count;
+	if (!portPins(port, &first, &count)) {
+		return;
+	}
+	std::lock_guard<std::mutex> guard(_private->lock);
+	unsigned long long mask = ((1ULL << count) - 1) << first;
+	_private->write(mask, (unsigned long long)value << first);
+}
+
+unsigned char SimulatedGpio::digitalReadPort(unsigned char port)
+{
+	unsigned char first, count;
+	if (!portPins(port, &first, &count)) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->pollStimulus();
+	return (unsigned char)((_private->levels() >> first) & ((1ULL << count) - 1));
+}
+
+unsigned int SimulatedGpio::analogRead(unsigned char pin)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	return pin < constMaxPins ? _private->analogInputs[pin] : 0;
+}
+
+void SimulatedGpio::analogWrite(unsigned char pin, unsigned int value)
+{
+	if (pin >= constMaxPins) {
+		return;
+	}
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->analogOutputs[pin] = value;
+	// like a pin without PWM when seen as digital output
+	_private->write(pinBit(pin), value >= 128 ? pinBit(pin) : 0);
+}
+
+void SimulatedGpio::beginTransaction()
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->transaction = true;
+	_private->pendingMask = 0;
+	_private->pendingValues = 0;
+}
+
+void SimulatedGpio::commitTransaction()
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	if (!_private->transaction) {
+		return;
+	}
+	_private->transaction = false;
+	if (_private->pendingMask != 0) {
+		_private->write(_private->pendingMask, _private->pendingValues);
+	}
+}
+
+void SimulatedGpio::attachInterrupt(unsigned char pin, void (*isr)(void), int mode)
+{
+	if (pin >= constMaxPins || isr == NULL) {
+		return;
+	}
+	std::unique_lock<std::mutex> guard(_private->lock);
+	_private->handlers[pin] = isr;
+	_private->handlerModes[pin] = mode;
+	_private->attached |= pinBit(pin);
+	_private->startDispatcher(guard);
+}
+
+void SimulatedGpio::detachInterrupt(unsigned char pin)
+{
+	if (pin >= constMaxPins) {
+		return;
+	}
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->attached &= ~pinBit(pin);
+	_private->handlers[pin] = NULL;
+}
+
+void SimulatedGpio::stopInterrupts()
+{
+	{
+		std::lock_guard<std::mutex> guard(_private->lock);
+		_private->attached = 0;
+		memset(_private->handlers, 0, sizeof(_private->handlers));
+		_private->eventCount = 0;
+		_private->running = false;
+		_private->wake.notify_one();
+	}
+	if (!_private->dispatcher.joinable() || _private->dispatcher.get_id() == std::this_thread::get_id()) {
+		// called by a handler, the thread ends when it returns and is joined by the next start
+		return;
+	}
+	_private->dispatcher.join();
+}
+
+unsigned long long SimulatedGpio::interruptMicros()
+{
+	return _private->currentMicros;
+}
+
+unsigned long SimulatedGpio::droppedInterrupts()
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	return _private->dropped;
+}
+
+void SimulatedGpio::setInput(unsigned char pin, bool level)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->setInput(pin, level, constBenchNow);
+}
+
+void SimulatedGpio::releaseInput(unsigned char pin)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	unsigned long long before = _private->levels();
+	_private->driven &= ~pinBit(pin);
+	_private->queueChanges(before, constBenchNow);
+}
+
+void SimulatedGpio::setAnalogInput(unsigned char pin, unsigned int value)
+{
+	if (pin >= constMaxPins) {
+		return;
+	}
+	std::lock_guard<std::mutex> guard(_private->lock);
+	_private->analogInputs[pin] = value < 1023 ? value : 1023;
+}
+
+unsigned long long SimulatedGpio::outputs()
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	return _private->outputs;
+}
+
+unsigned int SimulatedGpio::analogOutput(unsigned char pin)
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	return pin < constMaxPins ? _private->analogOutputs[pin] : 0;
+}
+
+unsigned long long SimulatedGpio::outputReports()
+{
+	std::lock_guard<std::mutex> guard(_private->lock);
+	return _private->reports;
+}
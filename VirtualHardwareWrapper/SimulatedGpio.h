@@ -0,0 +1,118 @@
+/*
+  SimulatedGpio.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+// Simulated digital and analog pins of the board, used by GPIOWrapper instead of an
+// IO-Warrior with the serial number "SIMULATED" or VM_GPIO=SIMULATED. A test bench
+// drives the inputs and watches the outputs through instance().
+//
+// Pins are numbered like on the Arduino UNO, the ports map like on the ATmega328P:
+// port B (2) is pins 8 to 13, port C (3) is A0 to A5 (pins 14 to 19), port D (4) is
+// pins 0 to 7. Between beginTransaction() and commitTransaction() all output changes
+// are collected and take effect together, as one output report.
+//
+// Every level change of a pin with an attached interrupt is queued with the time of the
+// board clock, VirtualTime or the microseconds since the simulation started, and a
+// thread of its own calls the handlers in order. Input changes come from setInput(),
+// e.g. by a test bench, another board or a device model in this process, or from the
+// stimulus script of VM_GPIO_STIMULUS=<file>: lines "<microseconds> <pin> <0|1>",
+// ordered by time, '#' starts a comment.
+
+class SimulatedGpioPrivate;
+
+class __declspec(dllexport) SimulatedGpio
+{
+private: SimulatedGpioPrivate* _private;
+
+private: SimulatedGpio();
+
+public: ~SimulatedGpio();
+
+public: static SimulatedGpio& instance();
+
+	// True if GPIOWrapper should use the simulation for the serial number
+public: static bool selected(const char* serialNumber);
+
+	// Arduino modes INPUT (0), OUTPUT (1), INPUT_PULLUP (2)
+public: void pinMode(unsigned char pin, unsigned char mode);
+
+public: unsigned char digitalRead(unsigned char pin);
+
+public: void digitalWrite(unsigned char pin, unsigned char value);
+
+	// Pins 0 to 31 by bit, writes the pins in mask to the levels in values
+public: void digitalWriteMask(unsigned long mask, unsigned long values);
+
+public: unsigned long digitalReadMask(unsigned long mask);
+
+public: void digitalWritePort(unsigned char port, unsigned char value);
+
+public: unsigned char digitalReadPort(unsigned char port);
+
+public: unsigned int analogRead(unsigned char pin);
+
+public: void analogWrite(unsigned char pin, unsigned int value);
+
+public: void beginTransaction();
+
+public: void commitTransaction();
+
+	// Arduino modes LOW (0), CHANGE (1), FALLING (2), RISING (3). LOW calls the handler
+	// when the pin goes low, not repeatedly while it stays low.
+public: void attachInterrupt(unsigned char pin, void (*isr)(void), int mode);
+
+public: void detachInterrupt(unsigned char pin);
+
+	// Detaches all handlers and stops the interrupt thread
+public: void stopInterrupts();
+
+	// For a handler, board time in microseconds of the pin change it was called for
+public: unsigned long long interruptMicros();
+
+	// Pin changes lost because the queue was full
+public: unsigned long droppedInterrupts();
+
+	// Test bench side: levels driven into input pins from outside, undriven inputs
+	// read high with INPUT_PULLUP and low otherwise
+public: void setInput(unsigned char pin, bool level);
+
+public: void releaseInput(unsigned char pin);
+
+	// 10 bit value of analogRead()
+public: void setAnalogInput(unsigned char pin, unsigned int value);
+
+	// The output levels of the pins, bit per pin
+public: unsigned long long outputs();
+
+	// The duty cycle of analogWrite()
+public: unsigned int analogOutput(unsigned char pin);
+
+	// Number of times the outputs changed together, once per write or transaction
+public: unsigned long long outputReports();
+};
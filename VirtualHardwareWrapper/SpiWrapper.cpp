@@ -28,6 +28,7 @@
 
 #include <msclr\auto_gcroot.h>
 #include "SpiWrapper.h"
+#include "DeviceModels.h"
 
 using namespace System::Runtime::InteropServices; // Marshal
 using namespace VirtualHardwareNet;
@@ -37,11 +38,17 @@ class SpiWrapperPrivate
 {
   public:
     msclr::auto_gcroot<SpiNet^> spi;
+    // VM_SPI_MODELS: transfers go to the device models instead of the IO-Warrior
+    bool models;
 };
 
 SpiWrapper::SpiWrapper()
 {
   _private = new SpiWrapperPrivate();
+  _private->models = DeviceModels::instance().spiEnabled();
+  if (_private->models) {
+    return;
+  }
   _private->spi = gcnew SpiNet();
 }
 
@@ -52,22 +59,36 @@ SpiWrapper::~SpiWrapper()
 
 void SpiWrapper::begin()
 {
+  if (_private->models) {
+    return;
+  }
   _private->spi->Begin();
 }
 
 void SpiWrapper::end()
 {
+  if (_private->models) {
+    return;
+  }
   _private->spi->End();
 }
 
 void SpiWrapper::beginTransaction(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
 {
+  if (_private->models) {
+    // the models take any clock and mode
+    return;
+  }
   _private->spi->BeginTransaction(clock, bitOrder, dataMode);
 }
 
 void SpiWrapper::transfer(const unsigned char* tbuf, const unsigned char* rbuf,
                           unsigned int size)
 {
+  if (_private->models) {
+    DeviceModels::instance().spiTransfer(tbuf, (unsigned char*)rbuf, size);
+    return;
+  }
   array<unsigned char>^ tdata = gcnew array<unsigned char>(size);
   Marshal::Copy(System::IntPtr((void *)tbuf), tdata, 0, size);
   array<unsigned char>^ rdata = gcnew array<unsigned char>(size);
@@ -26,22 +26,29 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-#include <msclr\auto_gcroot.h>
+// Native implementation, millis() and micros() do not enter the CLR.
+// With VM_VIRTUAL_TIME set they read the simulated time of VirtualTime instead.
+
 #include "TimingWrapper.h"
+#include "MonotonicClock.h"
+#include "VirtualTime.h"
 
-using namespace System::Runtime::InteropServices; // Marshal
-using namespace VirtualHardwareNet;
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 
 class TimingWrapperPrivate
 {
-	public: msclr::auto_gcroot<Timing^> timing;
+	public: MonotonicClock clock;
+	// NULL in real time mode
+	public: VirtualTime* virtualTime;
 };
 
 TimingWrapper::TimingWrapper()
 {
 	_private = new TimingWrapperPrivate();
-	_private->timing = gcnew Timing();
+	_private->virtualTime = VirtualTime::enabled() ? &VirtualTime::instance() : NULL;
 }
 
 TimingWrapper::~TimingWrapper()
@@ -51,10 +58,42 @@ TimingWrapper::~TimingWrapper()
 
 unsigned int TimingWrapper::millis()
 {
-	return _private->timing->Millis();
+	if (_private->virtualTime != NULL) {
+		return (unsigned int)(_private->virtualTime->micros() / 1000);
+	}
+	return _private->clock.millis();
 }
 
 unsigned int TimingWrapper::micros()
 {
-	return _private->timing->Micros();
+	if (_private->virtualTime != NULL) {
+		return (unsigned int)_private->virtualTime->micros();
+	}
+	return _private->clock.micros();
+}
+
+void TimingWrapper::delay(unsigned int milliseconds)
+{
+	if (_private->virtualTime != NULL) {
+		_private->virtualTime->sleep(milliseconds * 1000ULL);
+		return;
+	}
+#ifdef _WIN32
+	Sleep(milliseconds);
+#else
+	usleep(milliseconds * 1000ULL);
+#endif
+}
+
+void TimingWrapper::delayMicroseconds(unsigned int microseconds)
+{
+	if (_private->virtualTime != NULL) {
+		_private->virtualTime->sleep(microseconds);
+		return;
+	}
+	// too short for the scheduler of the OS, spin like an Arduino
+	unsigned long long end = _private->clock.ticks()
+		+ MonotonicClock::scale(microseconds, 1000000ULL, _private->clock.frequency());
+	while (_private->clock.ticks() < end) {
+	}
 }
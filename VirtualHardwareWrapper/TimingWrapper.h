@@ -43,4 +43,9 @@ public: ~TimingWrapper();
 public: unsigned int millis();
 
 public: unsigned int micros();
+
+	// For delay() of the Arduino core, in virtual time mode the other boards run meanwhile
+public: void delay(unsigned int milliseconds);
+
+public: void delayMicroseconds(unsigned int microseconds);
 };
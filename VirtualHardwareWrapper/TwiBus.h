@@ -0,0 +1,53 @@
+/*
+  TwiBus.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "TwiDevice.h"
+
+// A virtual TWI bus as seen by one board or device model on it. VirtualTwiWrapper uses
+// an implementation instead of VirtualTwiServer depending on VM_TWI_TRANSPORT.
+class __declspec(dllexport) TwiBus
+{
+public: virtual ~TwiBus() {}
+
+	// Joins the bus, as slave of the address if the device is not NULL
+public: virtual bool begin(unsigned char address, TwiDevice* device) = 0;
+
+public: virtual void end() = 0;
+
+	// Returns 0 on success, 2 if no slave has the address, 4 on other errors like twi_writeTo()
+public: virtual unsigned char writeTo(unsigned char address, const unsigned char* buffer, unsigned int length) = 0;
+
+	// Returns the number of bytes read, 0 if no slave has the address
+public: virtual unsigned int readFrom(unsigned char address, unsigned char* buffer, unsigned int quantity) = 0;
+
+	// Duration of a transaction of bytes data bytes at 100 kHz, 9 clocks per byte with the address byte.
+	// In virtual time the master's clock advances by it, the device models only read the clock.
+protected: static unsigned long long transferMicros(unsigned int bytes) { return 90ULL * (bytes + 1); }
+};
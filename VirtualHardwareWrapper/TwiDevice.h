@@ -0,0 +1,45 @@
+/*
+  TwiDevice.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+// A slave on a virtual TWI bus, e.g. a slave sketch or a model of an I2C chip.
+// The bus calls it for every transaction addressed to it, one at a time.
+class __declspec(dllexport) TwiDevice
+{
+public: virtual ~TwiDevice() {}
+
+	// The master wrote quantity bytes to the device
+public: virtual void onReceive(const unsigned char* buffer, unsigned int quantity) = 0;
+
+	// The master reads up to quantity bytes, returns the number of bytes put into buffer
+public: virtual unsigned int onRequest(unsigned char* buffer, unsigned int quantity) = 0;
+
+	// False to NACK the address, e.g. while an EEPROM is busy with its write cycle
+public: virtual bool acknowledge() { return true; }
+};
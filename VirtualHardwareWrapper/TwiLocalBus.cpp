@@ -0,0 +1,141 @@
+/*
+  TwiLocalBus.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "TwiLocalBus.h"
+#include "VirtualTime.h"
+
+#include <mutex>
+#include <stddef.h>
+
+namespace
+{
+	// status codes of twi_writeTo()
+	const unsigned char constStatusSuccess = 0;
+	const unsigned char constStatusAddressNack = 2;
+
+	struct LocalBus
+	{
+		std::recursive_mutex lock;
+		TwiDevice* slaves[256];
+
+		LocalBus()
+			: slaves()
+		{
+		}
+	};
+
+	// stays for boards which end() after the static objects are gone
+	LocalBus& localBus()
+	{
+		static LocalBus* bus = new LocalBus();
+		return *bus;
+	}
+}
+
+class TwiLocalBusPrivate
+{
+	public: unsigned char address;
+	public: TwiDevice* device;
+
+	public: TwiLocalBusPrivate()
+		: address(0), device(NULL)
+	{
+	}
+};
+
+TwiLocalBus::TwiLocalBus()
+{
+	_private = new TwiLocalBusPrivate();
+}
+
+TwiLocalBus::~TwiLocalBus()
+{
+	end();
+	delete _private;
+}
+
+bool TwiLocalBus::begin(unsigned char address, TwiDevice* device)
+{
+	end();
+	if (device == NULL) {
+		return true;
+	}
+
+	LocalBus& bus = localBus();
+	std::lock_guard<std::recursive_mutex> guard(bus.lock);
+	if (bus.slaves[address] != NULL) {
+		// address in use
+		return false;
+	}
+	bus.slaves[address] = device;
+	_private->address = address;
+	_private->device = device;
+	return true;
+}
+
+void TwiLocalBus::end()
+{
+	if (_private->device == NULL) {
+		return;
+	}
+
+	LocalBus& bus = localBus();
+	std::lock_guard<std::recursive_mutex> guard(bus.lock);
+	bus.slaves[_private->address] = NULL;
+	_private->device = NULL;
+}
+
+unsigned char TwiLocalBus::writeTo(unsigned char address, const unsigned char* buffer, unsigned int length)
+{
+	if (VirtualTime::enabled()) {
+		VirtualTime::instance().advance(transferMicros(length));
+	}
+	LocalBus& bus = localBus();
+	std::lock_guard<std::recursive_mutex> guard(bus.lock);
+	TwiDevice* slave = bus.slaves[address];
+	if (slave == NULL || !slave->acknowledge()) {
+		return constStatusAddressNack;
+	}
+	slave->onReceive(buffer, length);
+	return constStatusSuccess;
+}
+
+unsigned int TwiLocalBus::readFrom(unsigned char address, unsigned char* buffer, unsigned int quantity)
+{
+	if (VirtualTime::enabled()) {
+		VirtualTime::instance().advance(transferMicros(quantity));
+	}
+	LocalBus& bus = localBus();
+	std::lock_guard<std::recursive_mutex> guard(bus.lock);
+	TwiDevice* slave = bus.slaves[address];
+	if (slave == NULL || !slave->acknowledge()) {
+		return 0;
+	}
+	unsigned int count = slave->onRequest(buffer, quantity);
+	return count < quantity ? count : quantity;
+}
@@ -0,0 +1,55 @@
+/*
+  TwiLocalBus.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "TwiBus.h"
+
+// Virtual TWI bus between the boards and device models of this process. A master calls
+// the TwiDevice of the addressed slave directly on its own thread, the bus lets one
+// transaction run at a time like a real bus. A device may use the bus itself while it
+// is called.
+
+class TwiLocalBusPrivate;
+
+class __declspec(dllexport) TwiLocalBus : public TwiBus
+{
+private: TwiLocalBusPrivate* _private;
+
+public: TwiLocalBus();
+
+public: virtual ~TwiLocalBus();
+
+public: virtual bool begin(unsigned char address, TwiDevice* device);
+
+public: virtual void end();
+
+public: virtual unsigned char writeTo(unsigned char address, const unsigned char* buffer, unsigned int length);
+
+public: virtual unsigned int readFrom(unsigned char address, unsigned char* buffer, unsigned int quantity);
+};
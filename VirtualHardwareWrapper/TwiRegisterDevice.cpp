@@ -0,0 +1,91 @@
+/*
+  TwiRegisterDevice.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "TwiRegisterDevice.h"
+#include "MonotonicClock.h"
+#include "VirtualTime.h"
+
+TwiRegisterDevice::TwiRegisterDevice(const RegisterDefinition* definitions, unsigned int count, unsigned int pointerBytes)
+	: registers(definitions, count), pointerBytes(pointerBytes), pointer(0)
+{
+}
+
+unsigned long long TwiRegisterDevice::micros()
+{
+	if (VirtualTime::enabled()) {
+		// only observe the clock, a model on a service thread must not move the board's time
+		return VirtualTime::instance().peekMicros();
+	}
+	return MonotonicClock::systemMicros();
+}
+
+void TwiRegisterDevice::onReceive(const unsigned char* buffer, unsigned int quantity)
+{
+	update();
+	if (quantity < pointerBytes) {
+		// address probe, or not even the register pointer
+		return;
+	}
+
+	pointer = 0;
+	for (unsigned int i = 0; i < pointerBytes; i++) {
+		pointer = (pointer << 8) | buffer[i];
+	}
+	for (unsigned int i = pointerBytes; i < quantity; i++) {
+		writeRegister(pointer, buffer[i]);
+		pointer = nextRegister(pointer, true);
+	}
+	if (quantity > pointerBytes) {
+		writeEnded(quantity - pointerBytes);
+	}
+}
+
+unsigned int TwiRegisterDevice::onRequest(unsigned char* buffer, unsigned int quantity)
+{
+	update();
+	for (unsigned int i = 0; i < quantity; i++) {
+		buffer[i] = readRegister(pointer);
+		pointer = nextRegister(pointer, false);
+	}
+	return quantity;
+}
+
+unsigned char TwiRegisterDevice::readRegister(unsigned int address)
+{
+	return registers.value((unsigned char)address);
+}
+
+void TwiRegisterDevice::writeRegister(unsigned int address, unsigned char value)
+{
+	registers.write((unsigned char)address, value);
+}
+
+unsigned int TwiRegisterDevice::nextRegister(unsigned int address, bool /*writing*/)
+{
+	return (address + 1) & 0xff;
+}
@@ -0,0 +1,69 @@
+/*
+  TwiRegisterDevice.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "RegisterMap.h"
+#include "TwiDevice.h"
+
+// Base of the models of register based I2C chips. A write sets the register pointer
+// from its first pointerBytes bytes (most significant first), further bytes are written
+// to the registers. A read returns the registers from the pointer on. The pointer moves
+// on after every byte, by default to the next register.
+//
+// The models override the virtual functions for side effects. update() runs before every
+// transaction, so models evaluate their timing lazily against micros().
+
+class __declspec(dllexport) TwiRegisterDevice : public TwiDevice
+{
+protected: RegisterMap registers;
+protected: unsigned int pointerBytes;
+protected: unsigned int pointer;
+
+public: TwiRegisterDevice(const RegisterDefinition* definitions, unsigned int count, unsigned int pointerBytes);
+
+public: virtual void onReceive(const unsigned char* buffer, unsigned int quantity);
+
+public: virtual unsigned int onRequest(unsigned char* buffer, unsigned int quantity);
+
+	// Microseconds of the board clock, simulated in virtual time mode. Reading it does not
+	// advance the simulated time, the master's bus transactions do.
+public: static unsigned long long micros();
+
+protected: virtual void update() {}
+
+protected: virtual unsigned char readRegister(unsigned int address);
+
+protected: virtual void writeRegister(unsigned int address, unsigned char value);
+
+	// The register after address, writing tells if the master writes or reads
+protected: virtual unsigned int nextRegister(unsigned int address, bool writing);
+
+	// After a write with count data bytes, at the stop condition
+protected: virtual void writeEnded(unsigned int /*count*/) {}
+};
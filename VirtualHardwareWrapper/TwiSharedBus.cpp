@@ -0,0 +1,340 @@
+/*
+  TwiSharedBus.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "TwiSharedBus.h"
+#include "ProcessShared.h"
+#include "VirtualTime.h"
+
+#include <atomic>
+#include <string.h>
+#include <thread>
+
+namespace
+{
+	const unsigned int constMaxMembers = 64;
+	// a TWI transfer length is an unsigned char
+	const unsigned int constMaxData = 256;
+	// real time between checks for slaves which died during a transaction
+	const unsigned int constLivenessCheckMillis = 100;
+
+	const char* constSharedName = "VirtualBoard.TwiBus";
+
+	enum Request
+	{
+		requestNone = 0,
+		requestWrite = 1,
+		requestRead = 2
+	};
+
+	// status codes of twi_writeTo()
+	const unsigned char constStatusSuccess = 0;
+	const unsigned char constStatusAddressNack = 2;
+	const unsigned char constStatusOther = 4;
+
+	struct SharedMember
+	{
+		int pid;
+		int attached;
+		int slave;
+		unsigned int address;
+		// changes with every begin(), tells a master its slave was replaced in this slot
+		unsigned int generation;
+
+		// mailbox of a slave, written by the requesting master
+		int request;
+		int requester;
+		int done;
+		// status of twi_writeTo() when done
+		int status;
+		// length of the request, of the answer when done
+		unsigned int length;
+		unsigned char data[constMaxData];
+	};
+
+	// valid when zeroed
+	struct SharedBus
+	{
+		unsigned int generations;
+		SharedMember members[constMaxMembers];
+	};
+
+	// every member has two signals, the slave thread and the master may wait at the same time
+	unsigned int serviceSignal(int member)
+	{
+		return 2 * member;
+	}
+
+	unsigned int masterSignal(int member)
+	{
+		return 2 * member + 1;
+	}
+}
+
+class TwiSharedBusPrivate
+{
+	public: ProcessShared memory;
+	public: SharedBus* shared;
+	public: int member;
+	public: TwiDevice* device;
+	public: std::thread service;
+	public: std::atomic<bool> serviceActive;
+	// the request or answer while the device is called without the lock
+	public: unsigned char buffer[constMaxData];
+
+	public: TwiSharedBusPrivate()
+		: shared(NULL), member(-1), device(NULL), serviceActive(false)
+	{
+	}
+
+	// Frees the members of dead processes, the lock must be held
+	public: void reclaimDeadMembers()
+	{
+		for (unsigned int i = 0; i < constMaxMembers; i++) {
+			SharedMember& other = shared->members[i];
+			if (other.attached && !ProcessShared::processAlive(other.pid)) {
+				other.attached = 0;
+			}
+		}
+	}
+
+	// The lock must be held
+	public: int findSlave(unsigned char address)
+	{
+		for (unsigned int i = 0; i < constMaxMembers; i++) {
+			SharedMember& other = shared->members[i];
+			if (other.attached && other.slave && other.address == address) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// Thread of a slave, serves the requests in its mailbox
+	public: void serve()
+	{
+		memory.lock();
+		SharedMember& self = shared->members[member];
+		while (serviceActive) {
+			if (self.request == requestNone || self.done) {
+				memory.wait(serviceSignal(member), constLivenessCheckMillis);
+				continue;
+			}
+
+			unsigned int length = self.length < constMaxData ? self.length : constMaxData;
+			self.status = constStatusSuccess;
+			if (!device->acknowledge()) {
+				self.status = constStatusAddressNack;
+				self.length = 0;
+			} else if (self.request == requestWrite) {
+				memcpy(buffer, self.data, length);
+				memory.unlock();
+				device->onReceive(buffer, length);
+				memory.lock();
+			} else {
+				memory.unlock();
+				unsigned int count = device->onRequest(buffer, length);
+				memory.lock();
+				self.length = count < length ? count : length;
+				memcpy(self.data, buffer, self.length);
+			}
+			self.done = 1;
+			memory.signal(masterSignal(self.requester));
+		}
+		memory.unlock();
+	}
+
+	// Returns the status of twi_writeTo(), reads into buffer for requestRead
+	public: unsigned char transact(unsigned char address, int request, unsigned char* data, unsigned int* length)
+	{
+		if (shared == NULL || *length > constMaxData) {
+			return constStatusOther;
+		}
+
+		memory.lock();
+		int slave = findSlave(address);
+		// another master is using the mailbox, rare enough to poll
+		while (slave >= 0 && shared->members[slave].request != requestNone) {
+			memory.wait(masterSignal(member), 1);
+			reclaimDeadMembers();
+			slave = findSlave(address);
+			if (slave >= 0 && shared->members[slave].done && !shared->members[shared->members[slave].requester].attached) {
+				// the other master died before it collected the answer
+				shared->members[slave].request = requestNone;
+				shared->members[slave].done = 0;
+			}
+		}
+		if (slave < 0) {
+			memory.unlock();
+			return constStatusAddressNack;
+		}
+
+		SharedMember& target = shared->members[slave];
+		unsigned int generation = target.generation;
+		target.request = request;
+		target.requester = member;
+		target.done = 0;
+		target.length = *length;
+		if (request == requestWrite) {
+			memcpy(target.data, data, *length);
+		}
+		memory.signal(serviceSignal(slave));
+
+		while (!target.done || target.generation != generation) {
+			if (target.generation != generation) {
+				// the slave died and a new member took its slot before the liveness check
+				memory.unlock();
+				return constStatusOther;
+			}
+			if (!target.attached) {
+				// the slave left the bus or died
+				target.request = requestNone;
+				memory.unlock();
+				return constStatusOther;
+			}
+			if (!memory.wait(masterSignal(member), constLivenessCheckMillis)) {
+				reclaimDeadMembers();
+			}
+		}
+
+		unsigned char status = (unsigned char)target.status;
+		if (request == requestRead) {
+			*length = target.length < *length ? target.length : *length;
+			memcpy(data, target.data, *length);
+		}
+		target.request = requestNone;
+		target.done = 0;
+		memory.unlock();
+		return status;
+	}
+};
+
+TwiSharedBus::TwiSharedBus()
+{
+	_private = new TwiSharedBusPrivate();
+}
+
+TwiSharedBus::~TwiSharedBus()
+{
+	end();
+	delete _private;
+}
+
+bool TwiSharedBus::begin(unsigned char address, TwiDevice* device)
+{
+	end();
+	if (!_private->memory.open(constSharedName, sizeof(SharedBus), 2 * constMaxMembers)) {
+		return false;
+	}
+	_private->shared = (SharedBus*)_private->memory.memory();
+
+	_private->memory.lock();
+	_private->reclaimDeadMembers();
+	if (device != NULL && _private->findSlave(address) >= 0) {
+		// address in use
+		_private->memory.unlock();
+		end();
+		return false;
+	}
+	for (unsigned int i = 0; i < constMaxMembers; i++) {
+		if (!_private->shared->members[i].attached) {
+			_private->member = i;
+			break;
+		}
+	}
+	if (_private->member < 0) {
+		_private->memory.unlock();
+		end();
+		return false;
+	}
+
+	SharedMember& self = _private->shared->members[_private->member];
+	memset(&self, 0, sizeof(SharedMember));
+	self.pid = ProcessShared::currentProcessId();
+	self.slave = device != NULL;
+	self.address = address;
+	self.generation = ++_private->shared->generations;
+	self.attached = 1;
+	_private->memory.unlock();
+
+	_private->device = device;
+	if (device != NULL) {
+		_private->serviceActive = true;
+		_private->service = std::thread(&TwiSharedBusPrivate::serve, _private);
+	}
+	return true;
+}
+
+void TwiSharedBus::end()
+{
+	if (_private->shared == NULL) {
+		return;
+	}
+
+	if (_private->service.joinable()) {
+		_private->serviceActive = false;
+		_private->memory.lock();
+		_private->memory.signal(serviceSignal(_private->member));
+		_private->memory.unlock();
+		_private->service.join();
+	}
+
+	if (_private->member >= 0) {
+		_private->memory.lock();
+		SharedMember& self = _private->shared->members[_private->member];
+		self.attached = 0;
+		if (self.request != requestNone) {
+			// a master waits for this slave
+			_private->memory.signal(masterSignal(self.requester));
+		}
+		_private->memory.unlock();
+		_private->member = -1;
+	}
+
+	_private->memory.close();
+	_private->shared = NULL;
+	_private->device = NULL;
+}
+
+unsigned char TwiSharedBus::writeTo(unsigned char address, const unsigned char* buffer, unsigned int length)
+{
+	if (VirtualTime::enabled()) {
+		VirtualTime::instance().advance(transferMicros(length));
+	}
+	return _private->transact(address, requestWrite, (unsigned char*)buffer, &length);
+}
+
+unsigned int TwiSharedBus::readFrom(unsigned char address, unsigned char* buffer, unsigned int quantity)
+{
+	if (VirtualTime::enabled()) {
+		VirtualTime::instance().advance(transferMicros(quantity));
+	}
+	if (_private->transact(address, requestRead, buffer, &quantity) != constStatusSuccess) {
+		return 0;
+	}
+	return quantity;
+}
@@ -0,0 +1,55 @@
+/*
+  TwiSharedBus.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "TwiBus.h"
+
+// Virtual TWI bus between the processes of this machine in ProcessShared memory,
+// without VirtualTwiServer. Every process on the bus has a mailbox; a master puts its
+// request into the mailbox of the addressed slave and waits for the answer, a thread
+// of the slave process serves its TwiDevice.
+
+class TwiSharedBusPrivate;
+
+class TwiSharedBus : public TwiBus
+{
+private: TwiSharedBusPrivate* _private;
+
+public: TwiSharedBus();
+
+public: virtual ~TwiSharedBus();
+
+public: virtual bool begin(unsigned char address, TwiDevice* device);
+
+public: virtual void end();
+
+public: virtual unsigned char writeTo(unsigned char address, const unsigned char* buffer, unsigned int length);
+
+public: virtual unsigned int readFrom(unsigned char address, unsigned char* buffer, unsigned int quantity);
+};
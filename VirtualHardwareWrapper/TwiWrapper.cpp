@@ -28,6 +28,8 @@
 
 #include <msclr\auto_gcroot.h>
 #include "TwiWrapper.h"
+#include "DeviceModels.h"
+#include "TwiLocalBus.h"
 
 using namespace System::Runtime::InteropServices; // Marshal
 using namespace VirtualHardwareNet;
@@ -36,26 +38,42 @@ using namespace VirtualHardwareNet;
 class TwiWrapperPrivate
 {
   public: msclr::auto_gcroot<TwiNet^> twiNet;
+  // VM_TWI_MODELS: master on the bus of the device models instead of the IO-Warrior
+  public: TwiLocalBus* modelBus;
 };
 
 TwiWrapper::TwiWrapper()
 {
   _private = new class TwiWrapperPrivate();
+  _private->modelBus = NULL;
+  if (DeviceModels::instance().twiEnabled()) {
+    _private->modelBus = new TwiLocalBus();
+    return;
+  }
   _private->twiNet = gcnew TwiNet();
 }
 
 TwiWrapper::~TwiWrapper()
 {
+  delete _private->modelBus;
   delete _private;
 }
 
 void TwiWrapper::begin()
 {
+  if (_private->modelBus != NULL) {
+    _private->modelBus->begin(0, NULL);
+    return;
+  }
   _private->twiNet->Begin();
 }
 
 void TwiWrapper::end()
 {
+  if (_private->modelBus != NULL) {
+    _private->modelBus->end();
+    return;
+  }
   _private->twiNet->End();
 }
 
@@ -76,12 +94,19 @@ void TwiWrapper::attachSlaveRxEvent(void(*function)(unsigned char*, int))
 
 void TwiWrapper::setFrequency(unsigned int clock)
 {
+  if (_private->modelBus != NULL) {
+    // the models answer at once
+    return;
+  }
   _private->twiNet->SetFrequency(clock);
 }
 
 unsigned char TwiWrapper::readFrom(unsigned char address, unsigned char* rxBuffer,
                                    unsigned char quantity, unsigned char sendStop)
 {
+  if (_private->modelBus != NULL) {
+    return (unsigned char)_private->modelBus->readFrom(address, rxBuffer, quantity);
+  }
   array<unsigned char>^ data = gcnew array<unsigned char>(quantity);
   unsigned char result = _private->twiNet->ReadFrom(address, data, quantity, sendStop != 0);
   Marshal::Copy(data, 0, System::IntPtr((void *)rxBuffer), result);
@@ -91,6 +116,9 @@ unsigned char TwiWrapper::readFrom(unsigned char address, unsigned char* rxBuffe
 unsigned char TwiWrapper::writeTo(unsigned char txAddress, unsigned char* txBuffer,
                                   unsigned char txBufferLength, unsigned char wait, unsigned char sendStop)
 {
+  if (_private->modelBus != NULL) {
+    return _private->modelBus->writeTo(txAddress, txBuffer, txBufferLength);
+  }
   array<unsigned char>^ data = gcnew array<unsigned char>(txBufferLength);
   Marshal::Copy(System::IntPtr((void *)txBuffer), data, 0, txBufferLength);
   return _private->twiNet->WriteTo(txAddress, data, txBufferLength, wait != 0, sendStop != 0);
@@ -0,0 +1,338 @@
+/*
+  VirtualTime.cpp - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Native scheduler of the simulated time. The state of all boards lives in ProcessShared memory.
+// The board holding the token counts the time locally and publishes it when it sleeps.
+
+#include "VirtualTime.h"
+#include "ProcessShared.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	const unsigned int constMaxBoards = 64;
+	// real time between checks for boards which died while holding the token
+	const unsigned int constLivenessCheckMillis = 100;
+	// boards without VM_VIRTUAL_TIME_BOARD start after all numbered boards
+	const unsigned long long constFirstAttachOrder = 1ULL << 32;
+	const unsigned long long constFirstSleepOrder = 1ULL << 40;
+
+	const char* constSharedName = "VirtualBoard.VirtualTime";
+
+	enum BoardState
+	{
+		stateFree = 0,
+		stateIdle = 1,
+		stateRunning = 2
+	};
+
+	struct SharedBoard
+	{
+		int pid;
+		int state;
+		unsigned long long deadline;
+		// tie-breaker for equal deadlines
+		unsigned long long order;
+	};
+
+	// zeroed on creation, reset by reclaimDeadBoards() when no board is attached
+	struct SharedState
+	{
+		unsigned long long now;
+		unsigned long long nextOrder;
+		// board holding the token, -1 if none
+		int owner;
+		unsigned int attached;
+		unsigned int expected;
+		int started;
+		SharedBoard boards[constMaxBoards];
+	};
+
+	unsigned long long environmentNumber(const char* name, unsigned long long defaultValue)
+	{
+		const char* value = getenv(name);
+		if (value == NULL || *value == '\0') {
+			return defaultValue;
+		}
+		char* end;
+		unsigned long long number = strtoull(value, &end, 10);
+		return end == value ? defaultValue : number;
+	}
+}
+
+class VirtualTimePrivate
+{
+	public: ProcessShared memory;
+	public: SharedState* shared;
+	public: int board;
+	public: unsigned long long quantum;
+	// simulated time while this board holds the token
+	public: std::atomic<unsigned long long> now;
+
+	public: VirtualTimePrivate()
+		: shared(NULL), board(-1), quantum(1), now(0)
+	{
+	}
+
+	public: bool open()
+	{
+		if (!memory.open(constSharedName, sizeof(SharedState), constMaxBoards)) {
+			return false;
+		}
+		shared = (SharedState*)memory.memory();
+		return true;
+	}
+
+	public: void close()
+	{
+		memory.close();
+		shared = NULL;
+	}
+
+	public: void lock()
+	{
+		memory.lock();
+	}
+
+	public: void unlock()
+	{
+		memory.unlock();
+	}
+
+	// Frees the boards of dead processes, the lock must be held
+	public: void reclaimDeadBoards()
+	{
+		for (unsigned int i = 0; i < constMaxBoards; i++) {
+			SharedBoard& other = shared->boards[i];
+			if (other.state != stateFree && !ProcessShared::processAlive(other.pid)) {
+				other.state = stateFree;
+				shared->attached--;
+				if (shared->owner == (int)i) {
+					shared->owner = -1;
+				}
+			}
+		}
+		if (shared->attached == 0) {
+			// nothing left of a former run, start a new one
+			shared->now = 0;
+			shared->nextOrder = constFirstSleepOrder;
+			shared->owner = -1;
+			shared->expected = 0;
+			shared->started = 0;
+		}
+	}
+
+	// Hands the token to the idle board with the earliest deadline, the lock must be held
+	public: void dispatch()
+	{
+		if (!shared->started || shared->owner >= 0) {
+			return;
+		}
+
+		int next = -1;
+		for (unsigned int i = 0; i < constMaxBoards; i++) {
+			SharedBoard& other = shared->boards[i];
+			if (other.state != stateIdle) {
+				continue;
+			}
+			if (next < 0 || other.deadline < shared->boards[next].deadline
+				|| (other.deadline == shared->boards[next].deadline && other.order < shared->boards[next].order)) {
+				next = i;
+			}
+		}
+		if (next < 0) {
+			return;
+		}
+
+		SharedBoard& nextBoard = shared->boards[next];
+		nextBoard.state = stateRunning;
+		if (nextBoard.deadline > shared->now) {
+			shared->now = nextBoard.deadline;
+		}
+		shared->owner = next;
+		memory.signal(next);
+	}
+
+	// Blocks until this board holds the token, the lock must be held
+	public: void waitForToken()
+	{
+		while (shared->owner != board) {
+			if (!memory.wait(board, constLivenessCheckMillis) && shared->owner != board) {
+				reclaimDeadBoards();
+				dispatch();
+			}
+		}
+		now = shared->now;
+	}
+
+	public: bool attach(unsigned long long expected, unsigned long long boardNumber)
+	{
+		lock();
+		reclaimDeadBoards();
+		for (unsigned int i = 0; i < constMaxBoards; i++) {
+			if (shared->boards[i].state == stateFree) {
+				board = i;
+				break;
+			}
+		}
+		if (board < 0) {
+			unlock();
+			return false;
+		}
+
+		SharedBoard& self = shared->boards[board];
+		self.pid = ProcessShared::currentProcessId();
+		self.state = stateIdle;
+		self.deadline = shared->now;
+		self.order = boardNumber != ~0ULL ? boardNumber : constFirstAttachOrder + shared->attached;
+		shared->attached++;
+		if (shared->expected < expected) {
+			shared->expected = (unsigned int)expected;
+		}
+		if (shared->attached >= shared->expected) {
+			shared->started = 1;
+		}
+
+		dispatch();
+		waitForToken();
+		unlock();
+		return true;
+	}
+
+	public: void detach()
+	{
+		lock();
+		shared->boards[board].state = stateFree;
+		shared->attached--;
+		if (shared->owner == board) {
+			shared->now = now;
+			shared->owner = -1;
+			dispatch();
+		}
+		unlock();
+	}
+
+	public: void sleep(unsigned long long microseconds)
+	{
+		lock();
+		SharedBoard& self = shared->boards[board];
+		shared->now = now;
+		self.deadline = now + microseconds;
+		self.order = shared->nextOrder++;
+		self.state = stateIdle;
+		shared->owner = -1;
+		dispatch();
+		waitForToken();
+		unlock();
+	}
+};
+
+namespace
+{
+	// the board is detached at exit, the instance itself stays for late clock readings
+	VirtualTimePrivate* attachedBoard = NULL;
+
+	void detachAtExit()
+	{
+		if (attachedBoard != NULL && attachedBoard->shared != NULL) {
+			attachedBoard->detach();
+			attachedBoard->close();
+		}
+	}
+}
+
+VirtualTime::VirtualTime()
+{
+	_private = new VirtualTimePrivate();
+	_private->quantum = environmentNumber("VM_VIRTUAL_TIME_QUANTUM", 1);
+
+	unsigned long long expected = environmentNumber("VM_VIRTUAL_TIME", 1);
+	if (expected == 0 || expected > constMaxBoards) {
+		expected = 1;
+	}
+	if (!_private->open() || !_private->attach(expected, environmentNumber("VM_VIRTUAL_TIME_BOARD", ~0ULL))) {
+		fprintf(stderr, "VirtualTime: cannot attach to the shared simulated clock, running alone\n");
+		_private->close();
+		return;
+	}
+	attachedBoard = _private;
+	atexit(detachAtExit);
+}
+
+VirtualTime::~VirtualTime()
+{
+	if (attachedBoard == _private) {
+		attachedBoard = NULL;
+	}
+	if (_private->shared != NULL) {
+		_private->detach();
+		_private->close();
+	}
+	delete _private;
+}
+
+bool VirtualTime::enabled()
+{
+	const char* value = getenv("VM_VIRTUAL_TIME");
+	return value != NULL && *value != '\0' && strcmp(value, "0") != 0;
+}
+
+VirtualTime& VirtualTime::instance()
+{
+	static VirtualTime* virtualTime = new VirtualTime();
+	return *virtualTime;
+}
+
+unsigned long long VirtualTime::micros()
+{
+	return _private->now.fetch_add(_private->quantum) + _private->quantum;
+}
+
+unsigned long long VirtualTime::peekMicros()
+{
+	return _private->now.load();
+}
+
+void VirtualTime::advance(unsigned long long microseconds)
+{
+	_private->now += microseconds;
+}
+
+void VirtualTime::sleep(unsigned long long microseconds)
+{
+	if (_private->shared == NULL) {
+		// not attached, nobody else to run
+		_private->now += microseconds;
+		return;
+	}
+	_private->sleep(microseconds);
+}
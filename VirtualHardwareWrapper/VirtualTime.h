@@ -0,0 +1,73 @@
+/*
+  VirtualTime.h - Part of the VirtualBoard project
+
+  The VirtualBoard library allows editing, building and debugging Arduino sketches
+  in Visual C++ and Visual Studio IDE. The library emulates standard Arduino libraries
+  and connects them e.g. with the real serial ports and NIC of the computer.
+  Optionally, real binary and analogue I/O pins as well as I2C and SPI interfaces
+  can be controlled via an IO-Warrior device.
+  https://github.com/virtual-maker/VirtualBoard
+
+  Created by Immo Wache <virtual.mkr@gmail.com>
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+// Simulated time shared by all boards (processes) on this machine.
+//
+// Enabled by the environment variable VM_VIRTUAL_TIME=<number of boards>. The clock
+// starts when that many boards have attached. Exactly one board runs at a time; when it
+// sleeps in delay() or wait(), the idle board with the earliest deadline runs next and
+// the simulated time jumps straight to that deadline. Ties are resolved in the order the
+// boards went to sleep, so a scenario gives the same results on every run.
+//
+// Every clock reading advances the simulated time by VM_VIRTUAL_TIME_QUANTUM microseconds
+// (default 1), so sketches polling millis() in a busy loop still make progress.
+// VM_VIRTUAL_TIME_BOARD=<n> fixes the order of the first run of the boards, otherwise
+// they run in the order they attached.
+
+class VirtualTimePrivate;
+
+class VirtualTime
+{
+private: VirtualTimePrivate* _private;
+
+private: VirtualTime();
+
+public: ~VirtualTime();
+
+	// True if VM_VIRTUAL_TIME is set
+public: static bool enabled();
+
+	// The board of this process, attached and waiting for its first turn on the first call
+public: static VirtualTime& instance();
+
+	// Simulated microseconds since the clock started
+public: unsigned long long micros();
+
+	// The simulated microseconds without advancing them, for stamping events of other
+	// threads such as a test bench, whose timing must not move the clock of the board
+public: unsigned long long peekMicros();
+
+	// Let the other boards run until the simulated time has advanced by microseconds
+public: void sleep(unsigned long long microseconds);
+
+	// Let the simulated time of this board pass without giving the other boards a turn,
+	// e.g. for the duration of a bus transaction
+public: void advance(unsigned long long microseconds);
+};
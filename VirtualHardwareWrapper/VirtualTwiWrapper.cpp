@@ -27,20 +27,81 @@
 */
 
 #include <msclr\auto_gcroot.h>
+#include <stdlib.h>
+#include <string.h>
 #include "VirtualTwiWrapper.h"
+#include "TwiLocalBus.h"
+#include "TwiSharedBus.h"
 
 using namespace System::Runtime::InteropServices; // Marshal
 using namespace VirtualHardwareNet;
 
+// the receive buffer of Wire, a slave never gets longer frames
+const unsigned int constRxBufferLength = 32;
+// frames received in a row stay valid for a while after their callback
+const unsigned int constRxPoolSize = 4;
+
+
+// The sketch as a device on a native bus, transmit() fills the answer of onRequest()
+class VirtualTwiSlave : public TwiDevice
+{
+  public: VirtualTwiWrapper* owner;
+  public: unsigned char* answer;
+  public: unsigned int answerCapacity;
+  public: unsigned int answerLength;
+
+  public: virtual void onReceive(const unsigned char* buffer, unsigned int quantity)
+  {
+    owner->OnSlaveRxEvent((unsigned char*)buffer, quantity);
+  }
+
+  public: virtual unsigned int onRequest(unsigned char* buffer, unsigned int quantity)
+  {
+    answer = buffer;
+    answerCapacity = quantity;
+    answerLength = 0;
+    owner->OnSlaveTxEvent();
+    answer = NULL;
+    return answerLength;
+  }
+
+  public: void transmit(const unsigned char* buffer, unsigned int quantity)
+  {
+    if (answer == NULL) {
+      return;
+    }
+    if (quantity > answerCapacity - answerLength) {
+      quantity = answerCapacity - answerLength;
+    }
+    memcpy(answer + answerLength, buffer, quantity);
+    answerLength += quantity;
+  }
+};
 
 class VirtualTwiWrapperPrivate
 {
   public: msclr::auto_gcroot<VirtualTwiNet^> virtualTwiNet;
+  // VM_TWI_TRANSPORT=shm or local: native bus instead of VirtualTwiServer
+  public: TwiBus* nativeBus;
+  public: VirtualTwiSlave slave;
+  public: unsigned char address;
+
+  // received frames are handed to the callback as a view into the pool
+  public: unsigned char rxPool[constRxPoolSize][constRxBufferLength];
+  public: unsigned int rxNext;
+
+  public: unsigned char* nextRxBuffer()
+  {
+    unsigned char* buffer = rxPool[rxNext];
+    rxNext = (rxNext + 1) % constRxPoolSize;
+    return buffer;
+  }
 };
 
 private ref class VirtualTwiWrapperHelper
 {
   public: VirtualTwiWrapper* mPtr;
+  public: VirtualTwiWrapperPrivate* mPrivate;
 
   public: void OnSlaveTxEvent();
   public: void OnSlaveRxEvent(array<unsigned char>^ data, unsigned int quantity);
@@ -55,18 +116,44 @@ void VirtualTwiWrapperHelper::OnSlaveTxEvent()
 // https://social.msdn.microsoft.com/Forums/vstudio/en-US/ffe5a9e9-df86-4d93-b527-6d6ad3114ea4/ccli-managed-byte-array-to-byte-and-viceversa?forum=vcgeneral
 void VirtualTwiWrapperHelper::OnSlaveRxEvent(array<unsigned char>^ data, unsigned int quantity)
 {
-  unsigned char* buffer = new unsigned char[data->Length];
-  Marshal::Copy(data, 0, System::IntPtr(buffer), data->Length);
+  unsigned int length = (unsigned int)data->Length;
+  if (length > quantity) {
+    length = quantity;
+  }
+  if (length > constRxBufferLength) {
+    length = constRxBufferLength;
+  }
+  unsigned char* buffer = mPrivate->nextRxBuffer();
+  Marshal::Copy(data, 0, System::IntPtr(buffer), (int)length);
 
-  mPtr->OnSlaveRxEvent(buffer, quantity);
+  mPtr->OnSlaveRxEvent(buffer, length);
 }
 
 VirtualTwiWrapper::VirtualTwiWrapper()
 {
-  VirtualTwiWrapperHelper^ helper = gcnew VirtualTwiWrapperHelper;
-  helper->mPtr = this;
+  _onSlaveTransmit = NULL;
+  _onSlaveReceive = NULL;
 
   _private = new class VirtualTwiWrapperPrivate();
+  _private->nativeBus = NULL;
+  _private->slave.owner = this;
+  _private->slave.answer = NULL;
+  _private->address = 0;
+  _private->rxNext = 0;
+
+  const char* transport = getenv("VM_TWI_TRANSPORT");
+  if (transport != NULL && strcmp(transport, "shm") == 0) {
+    _private->nativeBus = new TwiSharedBus();
+    return;
+  }
+  if (transport != NULL && strcmp(transport, "local") == 0) {
+    _private->nativeBus = new TwiLocalBus();
+    return;
+  }
+
+  VirtualTwiWrapperHelper^ helper = gcnew VirtualTwiWrapperHelper;
+  helper->mPtr = this;
+  helper->mPrivate = _private;
   _private->virtualTwiNet = gcnew VirtualTwiNet();
 
   _private->virtualTwiNet->SlaveTxEvent += gcnew
@@ -79,21 +166,37 @@ VirtualTwiWrapper::VirtualTwiWrapper()
 
 VirtualTwiWrapper::~VirtualTwiWrapper()
 {
+  delete _private->nativeBus;
   delete _private;
 }
 
 void VirtualTwiWrapper::begin()
 {
+  if (_private->nativeBus != NULL) {
+    _private->nativeBus->begin(_private->address, _private->address != 0 ? &_private->slave : NULL);
+    return;
+  }
   _private->virtualTwiNet->init();
 }
 
 void VirtualTwiWrapper::end()
 {
+  if (_private->nativeBus != NULL) {
+    _private->nativeBus->end();
+    _private->address = 0;
+    return;
+  }
   _private->virtualTwiNet->disable();
 }
 
 void VirtualTwiWrapper::setAddress(unsigned char address)
 {
+  _private->address = address;
+  if (_private->nativeBus != NULL) {
+    // Wire.begin(address) sets the address after twi_init(), join again as slave
+    _private->nativeBus->begin(address, address != 0 ? &_private->slave : NULL);
+    return;
+  }
   _private->virtualTwiNet->setAddress(address);
 }
 
@@ -109,12 +212,28 @@ void VirtualTwiWrapper::attachSlaveRxEvent(void(*function)(unsigned char*, int))
 
 void VirtualTwiWrapper::setFrequency(unsigned int clock)
 {
+  if (_private->nativeBus != NULL) {
+    // transfers take no bus time
+    return;
+  }
   _private->virtualTwiNet->setFrequency(clock);
 }
 
+void VirtualTwiWrapper::setTimeout(unsigned long milliseconds)
+{
+  if (_private->nativeBus != NULL) {
+    // native slaves answer while the master waits, or leave the bus
+    return;
+  }
+  _private->virtualTwiNet->setTimeout(milliseconds);
+}
+
 unsigned char VirtualTwiWrapper::readFrom(unsigned char address, unsigned char* rxBuffer,
     unsigned char quantity, unsigned char sendStop)
 {
+  if (_private->nativeBus != NULL) {
+    return (unsigned char)_private->nativeBus->readFrom(address, rxBuffer, quantity);
+  }
   array<unsigned char>^ data = gcnew array<unsigned char>(quantity);
   unsigned char result = _private->virtualTwiNet->readFrom(address, data, quantity, sendStop != 0);
   Marshal::Copy(data, 0, System::IntPtr((void *)rxBuffer), result);
@@ -124,6 +243,9 @@ unsigned char VirtualTwiWrapper::readFrom(unsigned char address, unsigned char*
 unsigned char VirtualTwiWrapper::writeTo(unsigned char txAddress, unsigned char* txBuffer,
     unsigned char txBufferLength, unsigned char wait, unsigned char sendStop)
 {
+  if (_private->nativeBus != NULL) {
+    return _private->nativeBus->writeTo(txAddress, txBuffer, txBufferLength);
+  }
   array<unsigned char>^ data = gcnew array<unsigned char>(txBufferLength);
   Marshal::Copy(System::IntPtr((void *)txBuffer), data, 0, txBufferLength);
   return _private->virtualTwiNet->writeTo(txAddress, data, txBufferLength, wait != 0, sendStop != 0);
@@ -131,6 +253,10 @@ unsigned char VirtualTwiWrapper::writeTo(unsigned char txAddress, unsigned char*
 
 void VirtualTwiWrapper::transmit(const unsigned char* txBuffer, unsigned int quantity)
 {
+  if (_private->nativeBus != NULL) {
+    _private->slave.transmit(txBuffer, quantity);
+    return;
+  }
   array<unsigned char>^ data = gcnew array<unsigned char>(quantity);
   Marshal::Copy(System::IntPtr((void *)txBuffer), data, 0, quantity);
   return _private->virtualTwiNet->transmit(data, quantity);
@@ -51,6 +51,8 @@ class __declspec(dllexport) VirtualTwiWrapper
   public: void attachSlaveTxEvent(void(*function)(void));
   public: void attachSlaveRxEvent(void(*function)(unsigned char*, int));
   public: void setFrequency(unsigned int clock);
+  // Maximal time in milliseconds a slave may take to answer readFrom(), default 100
+  public: void setTimeout(unsigned long milliseconds);
   public: unsigned char readFrom(unsigned char address, unsigned char* rxBuffer,
                                    unsigned char quantity, unsigned char sendStop);
   public: unsigned char writeTo(unsigned char txAddress, unsigned char* txBuffer,
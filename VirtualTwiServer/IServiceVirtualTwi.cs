@@ -51,13 +51,11 @@ namespace VirtualTwiServer
         [OperationContract(IsOneWay = true)]
         void setFrequency(uint clock);
 
+        // Returns the number of bytes the slave answered within timeout milliseconds
         [OperationContract]
-        byte readFrom(byte address, ref byte[] rxBuffer, byte quantity, bool sendStop);
+        byte readFrom(byte address, ref byte[] rxBuffer, byte quantity, bool sendStop, uint timeout);
 
         [OperationContract]
         byte writeTo(byte txAddress, byte[] txBuffer, byte txBufferLength, bool wait, bool sendStop);
-
-        [OperationContract(IsOneWay = true)]
-        void transmit(byte[] data, uint quantity);
     }
 }
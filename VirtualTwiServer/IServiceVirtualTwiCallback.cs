@@ -39,13 +39,11 @@ namespace VirtualTwiServer
         [OperationContract(IsOneWay = true)]
         void Ping();
 
-        [OperationContract(IsOneWay = true)]
-        void SlaveTxCallback();
+        // The slave answers a read of the master in the reply, up to quantity bytes
+        [OperationContract]
+        byte[] SlaveTxCallback(byte quantity);
 
         [OperationContract(IsOneWay = true)]
         void SlaveRxCallback(byte[] data, uint quantity);
-
-        [OperationContract(IsOneWay = true)]
-        void MasterRxCallback(byte[] data, uint quantity);
     }
 }
@@ -31,6 +31,7 @@ using System.Collections.Generic;
 using System.Linq;
 using System.Text;
 using System.ServiceModel;
+using System.Threading.Tasks;
 using System.Timers;
 
 namespace VirtualTwiServer
@@ -142,21 +143,34 @@ namespace VirtualTwiServer
             // not implemented
         }
 
-        public byte readFrom(byte address, ref byte[] rxBuffer, byte quantity, bool sendStop)
+        public byte readFrom(byte address, ref byte[] rxBuffer, byte quantity, bool sendStop, uint timeout)
         {
             IServiceVirtualTwiCallback callbackChannel;
             if (!_callbackChannels.TryGetValue(address, out callbackChannel))
-                return 4;
-
+                return 0;
 
             if (!clientMaintainanceSuccessful(address, callbackChannel))
-                return 4;
+                return 0;
 
             try
             {
-                callbackChannel.SlaveTxCallback();
+                // the reply of the slave completes the request, a late reply is dropped
+                var request = Task.Run(() => callbackChannel.SlaveTxCallback(quantity));
+                if (!request.Wait((int)timeout))
+                {
+                    Console.WriteLine("TWI slave {0} did not answer within {1} ms.", address, timeout);
+                    return 0;
+                }
+
+                var data = request.Result;
+                if (data == null)
+                    return 0;
+
+                var count = data.Length > quantity ? quantity : data.Length;
+                rxBuffer = new byte[count];
+                Array.Copy(data, rxBuffer, count);
 //                Console.WriteLine("Request data from slave: {0}", address);
-                return 0;
+                return (byte)count;
             }
             catch (Exception ex)
             {
@@ -190,29 +204,6 @@ namespace VirtualTwiServer
             return 4;
         }
 
-        public void transmit(byte[] data, uint quantity)
-        {
-            byte address = 0;
-            IServiceVirtualTwiCallback callbackChannel;
-            if (!_callbackChannels.TryGetValue(address, out callbackChannel))
-                return;
-
-            if (!clientMaintainanceSuccessful(address, callbackChannel))
-                return;
-
-            try
-            {
-                callbackChannel.MasterRxCallback(data, quantity);
-//                Console.WriteLine("Send data to TWI master.");
-                return;
-            }
-            catch (Exception ex)
-            {
-                displayException(ex, address);
-                removeCallbackChannel(callbackChannel);
-            }
-        }
-
         private bool isValidChannel(byte address, IServiceVirtualTwiCallback callbackChannel)
         {
             if (_callbackChannels.ContainsKey(address))